@@ -5,14 +5,28 @@
 //#define DBG_VERBOSE
 
 #include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <limits.h>
 #include <time.h>
 #include <pthread.h>
+#include <sched.h>
 
 #include "fsm.h"
 #include "fsm_debug.h"
+#include "fsm_registry.h"
 
 // Global var to keep a trace of all steps created in order to free them at the end
 static struct fsm_queue *_all_steps_created = NULL;
+// Global var holding the compiled graph of steps, NULL if steps haven't been compiled
+static struct fsm_graph *_compiled_graph = NULL;
+// System events given to the steps, never modified nor given back to the pool so all the pointers share them
+static struct fsm_event _start_event = {
+        .id = _EVENT_START_POINTER_ID, .uid = _EVENT_START_POINTER_UID, .preallocated = true };
+static struct fsm_event _out_action_event = {
+        .id = _EVENT_OUT_ACTION_ID, .uid = _EVENT_OUT_ACTION_UID, .preallocated = true };
+static struct fsm_event _timeout_event = {
+        .id = _EVENT_TIMEOUT_ID, .uid = _EVENT_TIMEOUT_UID, .preallocated = true };
 
 /*! Wrapper for fsm_pop_front_queue that return an fsm_event
  *      @param queue Pointer to the fsm_queue
@@ -20,7 +34,7 @@ static struct fsm_queue *_all_steps_created = NULL;
  *  @retval NULL if the fsm_queue is empty
  *  @retval an fsm_queue pointer otherwise.
  *
- *  @note You should free the fsm_event after usage
+ *  @note You should release the fsm_event after usage
  *
  *  @see fsm_pop_front_queue(fsm_queue*)
  *  */
@@ -40,32 +54,371 @@ void _fsm_push_back_event_queue(struct fsm_queue *queue, struct fsm_event *event
     (struct fsm_event *) fsm_queue_push_back_more(queue, (void *) event, sizeof(event), 0);
 }
 
-/*! Return the older event from a fsm_queue or block until a new one appeared
- *      @param queue Pointer to the fsm_queue
+// Get the fsm_event in which a fsm_mpsc_node is embedded
+#define _fsm_event_of_mpsc_node(node) ((struct fsm_event *)((char *)(node) - offsetof(struct fsm_event, mpsc_node)))
+
+/*! Pop the next pending event of a pointer, must only be called by the pointer thread
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @retval NULL if there is no pending event
+ *  @retval The older pending fsm_event otherwise
+ *  */
+struct fsm_event *_fsm_pop_pending_event(struct fsm_pointer *pointer) {
+    struct fsm_event *event = pointer->input_pending;
+    if (event != NULL){
+        pointer->input_pending = event->next;
+        event->next = NULL;
+    }
+    return event;
+}
+
+/*! Turn a chain of fsm_queue_elem taken from the input queue into the pending events of a pointer
+ *      @param pointer Pointer to the fsm_pointer, with no pending event
+ *      @param elem First fsm_queue_elem of the chain, embedded into the events
+ *  */
+void _fsm_set_pending_events(struct fsm_pointer *pointer, struct fsm_queue_elem *elem) {
+    struct fsm_event **tail = &pointer->input_pending;
+    while (elem != NULL){
+        struct fsm_queue_elem *next = elem->next;
+        *tail = (struct fsm_event *) elem->value;
+        tail = &(*tail)->next;
+        elem = next;
+    }
+    *tail = NULL;
+}
+
+/*! Release all the pending events of a pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *  */
+void _fsm_release_pending_events(struct fsm_pointer *pointer) {
+    struct fsm_event *event;
+    while ((event = _fsm_pop_pending_event(pointer)) != NULL){
+        fsm_event_release(event);
+    }
+}
+
+/*! Get the absolute monotonic time at which the current step of a pointer times out
+ *      @param pointer Pointer to the fsm_pointer
  *
- *  @return A pointer to the older fsm_event stored into the queue.
+ *  @retval NULL if the current step has no timeout
+ *  @retval Pointer to the timeout of the current step otherwise
+ *  */
+static const struct timespec *_fsm_get_step_timeout(struct fsm_pointer *pointer) {
+    // The timeout of a pointer using a timer wheel comes as an event
+    return pointer->timeout_armed && pointer->config.timer_wheel == NULL ? &pointer->step_timeout : NULL;
+}
+
+/*! Generate a timeout fsm_event for a pointer which reached the timeout of its current step
+ *      @param pointer Pointer to the fsm_pointer
  *
- *  @note You should free the fsm_event after usage
+ *  @return Pointer to the preallocated timeout fsm_event
  *
+ *  @note The timeout is disarmed until the pointer enters a step again, so it's raised once
  *  */
-struct fsm_event *_fsm_get_event_or_wait(struct fsm_pointer *pointer) {
-//    if (pointer->config.ttl_activated && pointer->ttl_event->first != NULL){
-//        return _fsm_pop_front_event_queue(pointer->ttl_event);
-//    }
+static struct fsm_event *_fsm_generate_timeout_event(struct fsm_pointer *pointer) {
+    pointer->timeout_armed = false;
+    return &_timeout_event;
+}
+
+/*! Forget the events which could be coalesced, once they are taken from the input_event fsm_queue
+ *      @param pointer Pointer to the fsm_pointer, its input_event mutex must be held
+ *  */
+static void _fsm_forget_coalesced_events(struct fsm_pointer *pointer) {
+    for (unsigned int i = 0; i < pointer->n_coalesce; i++){
+        pointer->coalesce[i].pending = NULL;
+    }
+}
+
+/*! Take all the events of the input_event fsm_queue of a pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @retval NULL if the queue is empty
+ *  @retval The first fsm_queue_elem of the taken events otherwise
+ *  */
+static struct fsm_queue_elem *_fsm_take_input_events(struct fsm_pointer *pointer) {
     pthread_mutex_lock(&pointer->input_event.mutex);
-    while(pointer->input_event.first == NULL) {
-        if (pointer->current_step->timeout_us == 0) {
-            pthread_cond_wait(&pointer->input_event.cond, &pointer->input_event.mutex);
-        }else{
-            if(pthread_cond_timedwait(&pointer->cond_event, &pointer->input_event.mutex, &pointer->current_step->timeout) == ETIMEDOUT){
-                // If no event occurs and timeout raised
-                pthread_mutex_unlock(&pointer->input_event.mutex);
-                return fsm_generate_event(_EVENT_TIMEOUT_UID, NULL);
-            }
+    struct fsm_queue_elem *elems = fsm_queue_take_all(&pointer->input_event);
+    _fsm_forget_coalesced_events(pointer);
+    pthread_mutex_unlock(&pointer->input_event.mutex);
+    return elems;
+}
+
+/*! Tell a pointer that new events are into its input
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  The pointer thread is woken up if it's waiting, or the pointer is scheduled on its executor if it has one.
+ *  */
+static void _fsm_wake_pointer(struct fsm_pointer *pointer) {
+    if (pointer->config.executor != NULL){
+        _fsm_executor_schedule(pointer);
+    }else if (pointer->config.synchronous){
+        // Nobody waits, but the event loop of the application may poll the pointer
+        struct fsm_fd *fd = __atomic_load_n(&pointer->poll_fd, __ATOMIC_ACQUIRE);
+        if (fd != NULL){
+            fsm_fd_signal(fd);
         }
+    }else{
+        fsm_notify_wake(&pointer->input_notify);
     }
+}
+
+/*! Push an event of a coalesced ID into the input_event fsm_queue of a pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event
+ *
+ *  If an event of the same ID is still pending, it takes the arguments of the new one, which is released with the
+ *  old arguments.
+ *  */
+static void _fsm_push_coalesced_event(struct fsm_pointer *pointer, struct fsm_event *event) {
+    pthread_mutex_lock(&pointer->input_event.mutex);
+    struct fsm_event *pending = pointer->coalesce[event->id].pending;
+    if (pending == NULL){
+        fsm_queue_push_back_locked(&pointer->input_event, event);
+        pointer->coalesce[event->id].pending = event;
+        pthread_mutex_unlock(&pointer->input_event.mutex);
+        _fsm_wake_pointer(pointer);
+        return;
+    }
+    void *args = pending->args;
+    void (*args_free)(void *) = pending->args_free;
+    struct fsm_event *shared = pending->shared;
+    struct timespec ttl = pending->ttl;
+    pending->args = event->args;
+    pending->args_free = event->args_free;
+    pending->shared = event->shared;
+    pending->ttl = event->ttl;
+    // The old payload goes with nothing, the new one is simply copied
+    memcpy(pending->payload, event->payload, event->payload_size);
+    pending->payload_size = event->payload_size;
     pthread_mutex_unlock(&pointer->input_event.mutex);
-    return _fsm_pop_front_event_queue(&pointer->input_event);
+    event->args = args;
+    event->args_free = args_free;
+    event->shared = shared;
+    event->ttl = ttl;
+    fsm_event_release(event);
+}
+
+/*! Push an urgent event into its priority lane and wake the pointer up
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event, with a priority greater than 0
+ *  */
+static void _fsm_push_lane_event(struct fsm_pointer *pointer, struct fsm_event *event) {
+    unsigned int lane = event->priority < FSM_PRIORITY_LANES ? event->priority : FSM_PRIORITY_LANES - 1;
+    event->next = NULL;
+    pthread_mutex_lock(&pointer->lanes_mutex);
+    if (pointer->lanes_last[lane] != NULL){
+        pointer->lanes_last[lane]->next = event;
+    }else{
+        pointer->lanes_first[lane] = event;
+    }
+    pointer->lanes_last[lane] = event;
+    __atomic_or_fetch(&pointer->lanes_mask, 1u << lane, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&pointer->lanes_mutex);
+    if (pointer->input_ring != NULL && pointer->config.executor == NULL && !pointer->config.synchronous){
+        // The pointer thread waits on its ring
+        fsm_ring_kick(pointer->input_ring);
+    }else{
+        _fsm_wake_pointer(pointer);
+    }
+}
+
+/*! Pop the oldest event of the most urgent priority lane of a pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @retval NULL if every lane is empty
+ *  @retval The fsm_event otherwise
+ *  */
+static struct fsm_event *_fsm_pop_lane_event(struct fsm_pointer *pointer) {
+    if (__atomic_load_n(&pointer->lanes_mask, __ATOMIC_SEQ_CST) == 0){
+        return NULL;
+    }
+    pthread_mutex_lock(&pointer->lanes_mutex);
+    struct fsm_event *event = NULL;
+    if (pointer->lanes_mask != 0){
+        unsigned int lane = 31 - __builtin_clz(pointer->lanes_mask);
+        event = pointer->lanes_first[lane];
+        pointer->lanes_first[lane] = event->next;
+        if (event->next == NULL){
+            pointer->lanes_last[lane] = NULL;
+            __atomic_and_fetch(&pointer->lanes_mask, ~(1u << lane), __ATOMIC_SEQ_CST);
+        }
+        event->next = NULL;
+    }
+    pthread_mutex_unlock(&pointer->lanes_mutex);
+    return event;
+}
+
+/*! Check if an urgent event is waiting into a priority lane of a pointer
+ */
+static bool _fsm_has_lane_event(struct fsm_pointer *pointer) {
+    return __atomic_load_n(&pointer->lanes_mask, __ATOMIC_SEQ_CST) != 0;
+}
+
+/*! Push an event into the lock free input queue of a pointer and wake it up if it's waiting
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event to store
+ *
+ *  @note No lock is taken, the wake up costs a syscall only if the pointer thread is sleeping
+ *  */
+void _fsm_push_mpsc_event(struct fsm_pointer *pointer, struct fsm_event *event) {
+    fsm_mpsc_push(&pointer->input_mpsc, &event->mpsc_node);
+    _fsm_wake_pointer(pointer);
+}
+
+/*! Push several events into the lock free input queue of a pointer with a single atomic exchange and wake it up once
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param events Array of pointers to the fsm_event to store
+ *      @param n Number of events, greater than 0
+ *  */
+void _fsm_push_mpsc_events(struct fsm_pointer *pointer, struct fsm_event **events, unsigned int n) {
+    // Chain the nodes together before publishing them
+    for (unsigned int i = 0; i + 1 < n; i++){
+        events[i]->mpsc_node.next = &events[i + 1]->mpsc_node;
+    }
+    fsm_mpsc_push_chain(&pointer->input_mpsc, &events[0]->mpsc_node, &events[n - 1]->mpsc_node);
+    _fsm_wake_pointer(pointer);
+}
+
+/*! Return the older event from the lock free input queue of a pointer or block until a new one appeared
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @return A pointer to the older fsm_event, or a timeout fsm_event if the step timeout is reached
+ *
+ *  @note You should release the fsm_event after usage
+ *  */
+struct fsm_event *_fsm_get_mpsc_event_or_wait(struct fsm_pointer *pointer) {
+    struct fsm_mpsc_node *node;
+    while (1){
+        if (_fsm_has_lane_event(pointer)){
+            return _fsm_pop_lane_event(pointer);
+        }
+        node = fsm_mpsc_pop(&pointer->input_mpsc);
+        if (node != NULL){
+            return _fsm_event_of_mpsc_node(node);
+        }
+        if (!fsm_mpsc_is_empty(&pointer->input_mpsc)){
+            // A producer is in the middle of a push, let it finish
+            sched_yield();
+            continue;
+        }
+        // Producers wake up after their push : either they see us waiting or we see their event
+        unsigned int key = fsm_notify_prepare(&pointer->input_notify);
+        if (!fsm_mpsc_is_empty(&pointer->input_mpsc) || _fsm_has_lane_event(pointer)){
+            fsm_notify_cancel(&pointer->input_notify);
+            continue;
+        }
+        if (fsm_notify_wait_spin(&pointer->input_notify, key, _fsm_get_step_timeout(pointer), &pointer->input_spin) == ETIMEDOUT
+            && fsm_mpsc_is_empty(&pointer->input_mpsc) && !_fsm_has_lane_event(pointer)){
+            // If no event occurs and timeout raised
+            return _fsm_generate_timeout_event(pointer);
+        }
+    }
+}
+
+/*! Push an event into the bounded input of a pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event to store
+ *      @param policy Overflow policy to apply if the input is full
+ *
+ *  @retval 0 if the event is stored
+ *  @retval FSM_ERR_EVENT_DROPPED if the event have been released
+ *  @retval FSM_ERR_INPUT_FULL if the event have been refused
+ *  */
+int _fsm_push_ring_event(struct fsm_pointer *pointer, struct fsm_event *event, unsigned short policy) {
+    void *dropped = NULL;
+    int rc = 0;
+    switch (fsm_ring_push(pointer->input_ring, (void *) event, policy, &dropped)){
+        case FSM_RING_DROPPED:
+            fsm_event_release((struct fsm_event *) dropped);
+            rc = dropped == event ? FSM_ERR_EVENT_DROPPED : 0;
+            break;
+        case FSM_RING_FULL:
+            return FSM_ERR_INPUT_FULL;
+    }
+    if (pointer->config.executor != NULL || pointer->config.synchronous){
+        // The ring wakes up its own waiter, but a pointer without thread have to be scheduled or polled
+        _fsm_wake_pointer(pointer);
+    }
+    return rc;
+}
+
+/*! Return the older event from the bounded input of a pointer or block until a new one appeared
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @return A pointer to the older fsm_event, or a timeout fsm_event if the step timeout is reached
+ *
+ *  @note You should release the fsm_event after usage
+ *  */
+struct fsm_event *_fsm_get_ring_event_or_wait(struct fsm_pointer *pointer) {
+    while (1){
+        struct fsm_event *event = _fsm_pop_lane_event(pointer);
+        if (event != NULL){
+            return event;
+        }
+        if (__atomic_load_n(&pointer->stop_requested, __ATOMIC_ACQUIRE)){
+            // Joined : the events signaled before are handled, then the pointer stops
+            event = fsm_ring_pop(pointer->input_ring);
+            return event != NULL ? event : &pointer->stop_event;
+        }
+        const struct timespec *timeout = _fsm_get_step_timeout(pointer);
+        event = fsm_ring_pop_timedwait(pointer->input_ring, timeout);
+        if (event != NULL){
+            return event;
+        }
+        // Kicked because of an urgent event, or a kick left by an urgent event already handled
+        if (timeout != NULL && !fsm_time_check_absolute_time(*timeout) && !_fsm_has_lane_event(pointer)){
+            return _fsm_generate_timeout_event(pointer);
+        }
+    }
+}
+
+/*! Return the older event of a pointer or block until a new one appeared
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @return A pointer to the older fsm_event, or a timeout fsm_event if the step timeout is reached
+ *
+ *  Pending events (already taken from the input or put back by the TTL mechanism) are returned first, without any lock.
+ *  When there is none, all the events of the input queue are taken at once so a busy queue is locked once per batch
+ *  instead of twice per event.
+ *
+ *  @note You should release the fsm_event after usage
+ *
+ *  */
+struct fsm_event *_fsm_get_event_or_wait(struct fsm_pointer *pointer) {
+    if (_fsm_has_lane_event(pointer)){
+        return _fsm_pop_lane_event(pointer);
+    }
+    if (pointer->input_pending != NULL){
+        return _fsm_pop_pending_event(pointer);
+    }
+    if (pointer->input_ring != NULL){
+        return _fsm_get_ring_event_or_wait(pointer);
+    }
+    if (pointer->config.lockfree_input){
+        return _fsm_get_mpsc_event_or_wait(pointer);
+    }
+    struct fsm_queue_elem *elems = _fsm_take_input_events(pointer);
+    while (elems == NULL){
+        // Producers wake up after their push : either they see us waiting or we see their event
+        unsigned int key = fsm_notify_prepare(&pointer->input_notify);
+        if (_fsm_has_lane_event(pointer)){
+            fsm_notify_cancel(&pointer->input_notify);
+            return _fsm_pop_lane_event(pointer);
+        }
+        elems = _fsm_take_input_events(pointer);
+        if (elems != NULL){
+            fsm_notify_cancel(&pointer->input_notify);
+            break;
+        }
+        int rc = fsm_notify_wait_spin(&pointer->input_notify, key, _fsm_get_step_timeout(pointer), &pointer->input_spin);
+        elems = _fsm_take_input_events(pointer);
+        if (elems == NULL && rc == ETIMEDOUT && !_fsm_has_lane_event(pointer)){
+            // If no event occurs and timeout raised
+            return _fsm_generate_timeout_event(pointer);
+        }
+    }
+    _fsm_set_pending_events(pointer, elems);
+    return _fsm_pop_pending_event(pointer);
 }
 
 /*! Wrapper for fsm_push_back_queue that store a fsm_transition
@@ -99,8 +452,7 @@ struct fsm_transition *_fsm_get_reachable_transition(struct fsm_queue *queue,
     pthread_mutex_lock(&queue->mutex);
     struct fsm_queue_elem *cursor = queue->first;
     while (cursor != NULL){
-        //debug("Compare %s with %s", ((struct fsm_transition *)(cursor->value))->event_uid, event->uid);
-        if(strcmp(((struct fsm_transition *)(cursor->value))->event_uid, event->uid) == 0){
+        if(((struct fsm_transition *)(cursor->value))->event_id == event->id){
             pthread_mutex_unlock(&queue->mutex);
             return ((struct fsm_transition *)(cursor->value));
         }
@@ -114,7 +466,7 @@ struct fsm_conditional_transition *_fsm_get_reachable_conditional_transition(str
     pthread_mutex_lock(&queue->mutex);
     struct fsm_queue_elem *cursor = queue->first;
     while (cursor != NULL){
-        if(strcmp(((struct fsm_conditional_transition *)(cursor->value))->event_uid, event->uid) == 0){
+        if(((struct fsm_conditional_transition *)(cursor->value))->event_id == event->id){
             debug("_fsm_get_reachable_conditional_transition : found transition %s, fnct %p", event->uid, ((struct fsm_conditional_transition *)(cursor->value))->fnct);
             pthread_mutex_unlock(&queue->mutex);
             return ((struct fsm_conditional_transition *)(cursor->value));
@@ -125,6 +477,80 @@ struct fsm_conditional_transition *_fsm_get_reachable_conditional_transition(str
     return NULL;
 }
 
+/*! Search in a compiled step the transition which can be triggered by the given fsm_event
+ *      @param compiled Pointer to the fsm_compiled_step to search in
+ *      @param event Pointer to the fsm_event which could trigger a transition
+ *
+ *  @retval NULL if there is no transition to reach
+ *  @retval The fsm_compiled_transition triggered by the given fsm_event, which can be a conditional one
+ *
+ *  @note No lock is taken : a compiled step is never modified
+ *
+ *  */
+struct fsm_compiled_transition *_fsm_get_compiled_transition(struct fsm_compiled_step *compiled,
+                                                             struct fsm_event *event) {
+    // Binary search, transitions are sorted by event_id
+    unsigned int low = 0;
+    unsigned int high = compiled->n_transitions;
+    while (low < high){
+        unsigned int middle = (low + high) / 2;
+        if (compiled->transitions[middle].event_id < event->id){
+            low = middle + 1;
+        }else{
+            high = middle;
+        }
+    }
+    if (low < compiled->n_transitions && compiled->transitions[low].event_id == event->id){
+        return &compiled->transitions[low];
+    }
+    return NULL;
+}
+
+/*! Call a conditional transition function until it gives the step to go
+ *      @param context Pointer to the fsm_context gave to the functions
+ *      @param fnct First function of the conditional transition
+ *
+ *  @retval NULL if the pointer shouldn't move
+ *  @retval The fsm_step to reach otherwise
+ *  */
+struct fsm_step *_fsm_run_conditional_transition(struct fsm_context *context,
+                                                 struct fsm_conditional_move (*fnct)(struct fsm_context *)) {
+    struct fsm_conditional_move conditional_move;
+    debug("RUN CONDITIONAL FUNCTION %p", fnct);
+    while(true){
+        conditional_move = fnct(context);
+        if(conditional_move.step){
+            debug("END RUN CONDITIONAL FUNCTION");
+            return (struct fsm_step *)conditional_move.move;
+        }
+        fnct = conditional_move.move;
+    }
+}
+
+/*! Take the events kept by the TTL mechanism which can trigger a transition of a step
+ *      @param store Pointer to the fsm_ttl_store of the pointer
+ *      @param step Pointer to the fsm_step
+ *      @param list Head of the list receiving the events, in their arrival order
+ *  */
+static void _fsm_take_ttl_events_of_step(struct fsm_ttl_store *store, struct fsm_step *step, struct fsm_event **list) {
+    if (step->compiled != NULL){
+        for (unsigned int i = 0; i < step->compiled->n_transitions; i++){
+            fsm_ttl_store_take(store, step->compiled->transitions[i].event_id, list);
+        }
+        return;
+    }
+    pthread_mutex_lock(&step->transitions->mutex);
+    for (struct fsm_queue_elem *cursor = step->transitions->first; cursor != NULL; cursor = cursor->next){
+        fsm_ttl_store_take(store, ((struct fsm_transition *) cursor->value)->event_id, list);
+    }
+    pthread_mutex_unlock(&step->transitions->mutex);
+    pthread_mutex_lock(&step->conditional_transitions->mutex);
+    for (struct fsm_queue_elem *cursor = step->conditional_transitions->first; cursor != NULL; cursor = cursor->next){
+        fsm_ttl_store_take(store, ((struct fsm_conditional_transition *) cursor->value)->event_id, list);
+    }
+    pthread_mutex_unlock(&step->conditional_transitions->mutex);
+}
+
 /*! Start a step function with the appropriate context
  *      @param pointer Pointer to the fsm_pointer entering to the given step
  *      @param step Pointer to the new fsm_step to run
@@ -144,140 +570,290 @@ struct fsm_step *fsm_start_step(struct fsm_pointer *pointer, struct fsm_step *st
             .pointer = pointer,
             .fnct_arg = step->args,
     };
-    pthread_mutex_lock(&pointer->mutex);
-    if(pointer->running == FSM_STATE_STARTING) {
+    // Only the pointer thread changes the step, the mutex is taken only if some thread waits for it
+    if(__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) == FSM_STATE_STARTING) {
         // If it's the first step to be run, FSM is now running
-        pointer->running = FSM_STATE_RUNNING;
+        __atomic_store_n(&pointer->running, FSM_STATE_RUNNING, __ATOMIC_RELEASE);
     }else if (pointer->current_step->out_fnct != NULL){
         // If there is an out action to perform we call it before anything else
         struct fsm_context out_action_context = {
-                .event = fsm_generate_event(_EVENT_OUT_ACTION_UID, NULL),
+                .event = &_out_action_event,
                 .pointer = pointer,
                 .fnct_arg = pointer->current_step->out_args,
         };
         pointer->current_step->out_fnct(&out_action_context);
-        free(out_action_context.event);
     }
-    pointer->current_step = step;
-    if(pointer->current_step->timeout_us > 0){
-        // If there is a timeout, init it.
-        pointer->current_step->timeout = fsm_time_get_abs_fixed_time_from_us(pointer->current_step->timeout_us);
+    // Ordered before the read of the waiters, see _fsm_pointer_wait
+    __atomic_store_n(&pointer->current_step, step, __ATOMIC_SEQ_CST);
+    // If there is a timeout, init it. It's kept by the pointer as steps are shared between pointers
+    bool was_armed = pointer->timeout_armed;
+    pointer->timeout_armed = pointer->current_step->timeout_us > 0;
+    if(pointer->timeout_armed){
+        pointer->step_timeout = fsm_time_get_abs_fixed_time_from_us(pointer->current_step->timeout_us);
     }
-    pthread_cond_broadcast(&pointer->cond_event);
-    pthread_mutex_unlock(&pointer->mutex);
-    if(pointer->config.ttl_activated){
-        while (pointer->ttl_event->first != NULL){
-            fsm_queue_push_top_more(&pointer->input_event, fsm_queue_pop_front(pointer->ttl_event), sizeof(fsm_event), 0);
+    if(pointer->config.timer_wheel != NULL){
+        // Stale timeouts already fired are dropped when handled, see _fsm_pointer_handle_event
+        if(pointer->timeout_armed){
+            fsm_timer_arm(pointer->config.timer_wheel, &pointer->step_timer, &pointer->step_timeout);
+        }else if(was_armed){
+            fsm_timer_cancel(pointer->config.timer_wheel, &pointer->step_timer);
+        }
+    }
+    if(__atomic_load_n(&pointer->step_waiters, __ATOMIC_SEQ_CST) != NULL){
+        pthread_mutex_lock(&pointer->mutex);
+        _fsm_wake_step_waiters(pointer);
+        pthread_mutex_unlock(&pointer->mutex);
+    }
+    if(pointer->config.ttl_activated && pointer->ttl_store->count > 0){
+        // Events kept by the TTL mechanism which can trigger a transition of the step are tried again before the
+        // pending ones, in their arrival order
+        struct fsm_event *ttl_events = NULL;
+        fsm_ttl_store_purge(pointer->ttl_store);
+        _fsm_take_ttl_events_of_step(pointer->ttl_store, step, &ttl_events);
+        if (ttl_events != NULL){
+            struct fsm_event **tail = &ttl_events;
+            while (*tail != NULL){
+                tail = &(*tail)->next;
+            }
+            *tail = pointer->input_pending;
+            pointer->input_pending = ttl_events;
         }
     }
     return step->fnct(&init_context);
 }
 
 
-/*! Main loop for the pointer thread, run step and wait for events
- *      @param pointer Generic void pointer to the fsm_pointer which will be managed by the loop
+/*! Get the step to reach with a direct transition
+ *      @param step Pointer to the fsm_step
  *
- * The main loop of a pointer thread execute a step and wait for a transition
- * when this one ended.
+ *  @retval NULL if the step doesn't start with a direct transition
+ *  @retval The fsm_step to reach otherwise
+ *  */
+static struct fsm_step *_fsm_get_direct_step(struct fsm_step *step) {
+    if(step->compiled != NULL){
+        // The direct transition of a compiled step is already known
+        return step->compiled->direct_step;
+    }
+    if(step->transitions->first != NULL &&
+            ((struct fsm_transition *)(step->transitions->first->value))->event_id == _EVENT_DIRECT_TRANSITION_ID){
+        return ((struct fsm_transition *)(step->transitions->first->value))->next_step;
+    }
+    return NULL;
+}
+
+/*! Follow the steps returned by callbacks and the direct transitions until the pointer needs a new event
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param ret_step Step returned by the last callback, can be NULL
+ *      @param event Event which triggered the current step, given to the next ones and released at the end
  *
- * @warning This function shouldn't be called from an other place that fsm_start_pointer function
+ *  @retval true if the pointer now waits for an event
+ *  @retval false if the pointer is closing
  *
- */
-void *fsm_pointer_loop(void *_pointer) {
-    struct fsm_pointer * pointer = _pointer;
+ *  @note The closing state is only checked here : a pointer waiting for events handles the ones signaled before
+ *  the closing event, but a pointer which doesn't watch its transitions (a direct loop for example) can still be joined
+ *  */
+static bool _fsm_pointer_settle(struct fsm_pointer *pointer, struct fsm_step *ret_step, struct fsm_event *event) {
+    while (1){
+        if(ret_step == NULL){
+            ret_step = _fsm_get_direct_step(pointer->current_step);
+            if(ret_step == NULL){
+                break;
+            }
+        }
+        if(__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) != FSM_STATE_RUNNING){
+            // If the pointer is asked to stopped (closing) it immediately free resources and stop
+            fsm_event_release(event);
+            return false;
+        }
+        ret_step = fsm_start_step(pointer, ret_step, event);
+    }
+    fsm_event_release(event);
+    return true;
+}
+
+/*! Run the first step of a pointer
+ *      @param pointer Pointer to the fsm_pointer, which current step is the first one
+ *
+ *  @retval true if the pointer now waits for an event
+ *  @retval false if the pointer is closing
+ *  */
+static bool _fsm_pointer_start(struct fsm_pointer *pointer) {
     // First event is the starting one, gave to the first step
-    struct fsm_event * new_event = fsm_generate_event(_EVENT_START_POINTER_UID, NULL);
+    struct fsm_event *event = &_start_event;
     // Allow to start the first step without transition
-    struct fsm_step * ret_step = fsm_start_step(pointer, pointer->current_step, new_event);
-    // Now the pointer is running
-    struct fsm_transition * reachable_transition = NULL;
-    struct fsm_conditional_transition * reachable_conditional_transition = NULL;
-    struct fsm_conditional_move (*conditional_fnct)(struct fsm_context *) = NULL;
-    struct fsm_conditional_move conditional_move;
-    struct fsm_context init_context = {
-            .event = NULL,
+    return _fsm_pointer_settle(pointer, fsm_start_step(pointer, pointer->current_step, event), event);
+}
+
+/*! Make a pointer follow the transition triggered by an event if any
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event to handle, released or kept by the TTL mechanism
+ *
+ *  @retval true if the pointer now waits for an event
+ *  @retval false if the pointer is closing
+ *  */
+static bool _fsm_pointer_handle_event(struct fsm_pointer *pointer, struct fsm_event *event) {
+    struct fsm_context context = {
+            .event = event,
             .pointer = pointer,
             .fnct_arg = NULL,
     };
-    while (1){
-        if(pointer->running != FSM_STATE_RUNNING){
-            // If the pointer is asked to stopped (closing) it immediately free resources and stop
-            free(new_event);
-            break;
-        }
-        if(ret_step != NULL){
-            // If a step have return a step it directly jump to it
-            ret_step = fsm_start_step(pointer, ret_step, new_event);
-            continue;
+    if (event->id == _EVENT_STOP_POINTER_ID){
+        // If the closing event have been given to the pointer it close and free his resources
+        fsm_event_release(event);
+        return false;
+    }
+    if (event->id == _EVENT_TIMER_ID){
+        if (!pointer->timeout_armed || fsm_time_check_absolute_time(pointer->step_timeout)){
+            // The timer have been armed by a step already left
+            fsm_event_release(event);
+            return true;
         }
-        if(pointer->current_step->transitions->first != NULL){
-            // Check if there isn't a direct transition to perform
-            if(strcmp(((struct fsm_transition *)(pointer->current_step->transitions->first->value))->event_uid,
-                      _EVENT_DIRECT_TRANSITION_UID) == 0){
-                // Then we direct go to next step
-                ret_step = fsm_start_step(pointer, ((struct fsm_transition *)
-                        (pointer->current_step->transitions->first->value))->next_step, new_event);
-                continue;
+        pointer->timeout_armed = false;
+        event->id = _EVENT_TIMEOUT_ID;
+        event->uid = fsm_registry_uid(_EVENT_TIMEOUT_ID);
+    }
+    if (pointer->current_step->compiled != NULL){
+        // Transitions and conditional transitions of a compiled step are found with one search
+        struct fsm_compiled_transition *compiled_transition =
+                _fsm_get_compiled_transition(pointer->current_step->compiled, event);
+        if (compiled_transition != NULL){
+            if (compiled_transition->fnct == NULL){
+                return _fsm_pointer_settle(pointer, fsm_start_step(pointer, compiled_transition->next_step, event), event);
             }
+            return _fsm_pointer_settle(pointer, _fsm_run_conditional_transition(&context, compiled_transition->fnct), event);
         }
-        free(new_event);
-        new_event = _fsm_get_event_or_wait(pointer);
-        if (new_event != NULL){
-            if (strcmp(new_event->uid, _EVENT_STOP_POINTER_UID) == 0){
-                // If the closing event have been given to the pointer it close and free his resources
-                free(new_event);
-                break;
-            }
-            // Search a transition which could be triggered by the new_event
-            reachable_transition = _fsm_get_reachable_transition(
-                    pointer->current_step->transitions, new_event);
-            if (reachable_transition != NULL){
-                // If there is one pointer jump to it and continue the loop
-                ret_step = fsm_start_step(pointer, reachable_transition->next_step, new_event);
-                continue;
-            }
-            // Search for a conditional transition which could be triggered by the new event
-            reachable_conditional_transition = _fsm_get_reachable_conditional_transition(
-                    pointer->current_step->conditional_transitions, new_event);
-            if (reachable_conditional_transition != NULL){
-                // If there is a conditional transition, call it
-                init_context.event = new_event;
-                init_context.fnct_arg = NULL;
-                debug("RUN CONDITIONAL FUNCTION %p, %p", reachable_conditional_transition, reachable_conditional_transition->fnct);
-                conditional_fnct = reachable_conditional_transition->fnct;
-                while(true){
-                    conditional_move = conditional_fnct((&init_context));
-                    if(conditional_move.step){
-                        ret_step = (struct fsm_step *)conditional_move.move;
-                        break;
-                    }else{
-                        conditional_fnct = conditional_move.move;
-                    }
-                }
-                //ret_step = reachable_conditional_transition->fnct(&init_context);
-                debug("END RUN CONDITIONAL FUNCTION");
-                continue;
-            }
-            if (pointer->config.ttl_activated && fsm_time_check_absolute_time(new_event->ttl)){
-                // There is a TTL so don't delete it right now
-                debug("TTL event : %d s %d ns", new_event->ttl.tv_sec, new_event->ttl.tv_nsec);
-                _fsm_push_back_event_queue(pointer->ttl_event, new_event);
-                new_event = NULL; // To protect new_event to be free
-            }
-            // Otherwise it will wait for a new event
+    }else{
+        // Search a transition which could be triggered by the event
+        struct fsm_transition *reachable_transition = _fsm_get_reachable_transition(
+                pointer->current_step->transitions, event);
+        if (reachable_transition != NULL){
+            // If there is one pointer jump to it
+            return _fsm_pointer_settle(pointer, fsm_start_step(pointer, reachable_transition->next_step, event), event);
+        }
+        // Search for a conditional transition which could be triggered by the event
+        struct fsm_conditional_transition *reachable_conditional_transition =
+                _fsm_get_reachable_conditional_transition(pointer->current_step->conditional_transitions, event);
+        if (reachable_conditional_transition != NULL){
+            // If there is a conditional transition, call it
+            return _fsm_pointer_settle(pointer,
+                                       _fsm_run_conditional_transition(&context, reachable_conditional_transition->fnct),
+                                       event);
         }
-        // Condition
     }
+    if (pointer->config.ttl_activated && fsm_time_check_absolute_time(event->ttl)){
+        // There is a TTL so don't delete it right now
+        debug("TTL event : %d s %d ns", event->ttl.tv_sec, event->ttl.tv_nsec);
+        fsm_ttl_store_purge(pointer->ttl_store);
+        fsm_ttl_store_push(pointer->ttl_store, event);
+    }else{
+        fsm_event_release(event);
+    }
+    // Otherwise it will wait for a new event
+    return true;
+}
+
+/*! Run the out action of the current step of a stopping pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *  */
+static void _fsm_pointer_exit(struct fsm_pointer *pointer) {
     if (pointer->current_step->out_fnct != NULL){
         // If there is an out action to perform we call it before anything else
-        init_context.event = fsm_generate_event(_EVENT_OUT_ACTION_UID, NULL);
-        init_context.fnct_arg = pointer->current_step->out_args;
-        pointer->current_step->out_fnct(&init_context);
-        free(init_context.event);
+        struct fsm_context context = {
+                .event = &_out_action_event,
+                .pointer = pointer,
+                .fnct_arg = pointer->current_step->out_args,
+        };
+        pointer->current_step->out_fnct(&context);
     }
+}
+
+/*! Main loop for the pointer thread, run step and wait for events
+ *      @param pointer Generic void pointer to the fsm_pointer which will be managed by the loop
+ *
+ * The main loop of a pointer thread execute a step and wait for a transition
+ * when this one ended.
+ *
+ * @warning This function shouldn't be called from an other place that fsm_start_pointer function
+ *
+ */
+void *fsm_pointer_loop(void *_pointer) {
+    struct fsm_pointer * pointer = _pointer;
+    bool running = _fsm_pointer_start(pointer);
+    while (running){
+        running = _fsm_pointer_handle_event(pointer, _fsm_get_event_or_wait(pointer));
+    }
+    _fsm_pointer_exit(pointer);
     return NULL;
 }
 
+/*! Return the older event of a pointer without waiting
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @retval NULL if there is no event and the timeout of the current step isn't reached
+ *  @retval The older fsm_event, or a timeout fsm_event otherwise
+ *
+ *  @note You should release the fsm_event after usage
+ *  */
+static struct fsm_event *_fsm_try_get_event(struct fsm_pointer *pointer) {
+    struct fsm_event *event = _fsm_pop_lane_event(pointer);
+    if (event != NULL){
+        return event;
+    }
+    if (pointer->input_pending != NULL){
+        return _fsm_pop_pending_event(pointer);
+    }
+    if (pointer->input_ring != NULL){
+        event = fsm_ring_pop(pointer->input_ring);
+        if (event == NULL && __atomic_load_n(&pointer->stop_requested, __ATOMIC_ACQUIRE)){
+            // Joined : the events signaled before have been handled
+            return &pointer->stop_event;
+        }
+    }else if (pointer->config.lockfree_input){
+        // If a producer is in the middle of a push it will schedule the pointer again once done
+        struct fsm_mpsc_node *node = fsm_mpsc_pop(&pointer->input_mpsc);
+        if (node != NULL){
+            event = _fsm_event_of_mpsc_node(node);
+        }
+    }else{
+        struct fsm_queue_elem *elems = _fsm_take_input_events(pointer);
+        if (elems != NULL){
+            _fsm_set_pending_events(pointer, elems);
+            event = _fsm_pop_pending_event(pointer);
+        }
+    }
+    if (event == NULL && _fsm_get_step_timeout(pointer) != NULL && !fsm_time_check_absolute_time(pointer->step_timeout)){
+        return _fsm_generate_timeout_event(pointer);
+    }
+    return event;
+}
+
+int _fsm_pointer_run(struct fsm_pointer *pointer, unsigned int budget, const struct timespec **deadline,
+                     unsigned int *handled) {
+    *deadline = NULL;
+    if (handled != NULL){
+        *handled = 0;
+    }
+    if (__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) == FSM_STATE_STARTING && !_fsm_pointer_start(pointer)){
+        _fsm_pointer_exit(pointer);
+        return FSM_POINTER_RUN_DONE;
+    }
+    for (unsigned int i = 0; i < budget; i++){
+        struct fsm_event *event = _fsm_try_get_event(pointer);
+        if (event == NULL){
+            *deadline = _fsm_get_step_timeout(pointer);
+            return FSM_POINTER_RUN_IDLE;
+        }
+        if (handled != NULL){
+            (*handled)++;
+        }
+        if (!_fsm_pointer_handle_event(pointer, event)){
+            _fsm_pointer_exit(pointer);
+            return FSM_POINTER_RUN_DONE;
+        }
+    }
+    return FSM_POINTER_RUN_AGAIN;
+}
+
 /*! This function delete indeed a step
  *      @param step Pointer to the fsm_step to delete
  *
@@ -298,41 +874,57 @@ void _fsm_delete_a_step(fsm_step *step){
 struct fsm_step *fsm_create_step(void *(*fnct)(struct fsm_context *), void *args) {
     if (_all_steps_created == NULL){
         // Init _all_steps_created if it's still a NULL pointer
-        _all_steps_created = create_fsm_queue_pointer();
+        _all_steps_created = create_fsm_queue_intrusive_pointer(offsetof(struct fsm_step, queue_elem));
     }
     struct fsm_step *step = malloc(sizeof(struct fsm_step));
     // Add the new step into the _all_steps_created to free after
     step = fsm_queue_push_back_more(_all_steps_created, (void *) step, sizeof(*step), 0);
     step->fnct = fnct;
     step->args = args;
-    step->transitions = create_fsm_queue_pointer();
-    step->conditional_transitions = create_fsm_queue_pointer();
+    step->transitions = create_fsm_queue_intrusive_pointer(offsetof(struct fsm_transition, queue_elem));
+    step->conditional_transitions = create_fsm_queue_intrusive_pointer(
+            offsetof(struct fsm_conditional_transition, queue_elem));
     step->out_fnct = NULL;
     step->out_args = NULL;
-    step->timeout.tv_nsec = 0;
-    step->timeout.tv_sec = 0;
     step->timeout_us = 0;
+    step->id = 0;
+    step->compiled = NULL;
     return step;
 }
 
 
 void fsm_connect_step(struct fsm_step *from, struct fsm_step *to, char *event_uid) {
+    fsm_connect_step_id(from, to, fsm_registry_intern(event_uid));
+}
+
+void fsm_connect_step_id(struct fsm_step *from, struct fsm_step *to, fsm_event_id event_id) {
     struct fsm_transition transition = {
+            .event_id = event_id,
             .next_step = to,
     };
-    // Copy the event's UID to the transition
-    strcpy(transition.event_uid, event_uid);
+    if (from->compiled != NULL){
+        log_warn("Adding a transition to a compiled step release the compiled graph");
+        fsm_graph_release();
+    }
     // Add transition to the from transition queue
     _fsm_push_back_transition_queue(from->transitions, &transition);
 }
 
-void fsm_add_conditional_transition_to_step(struct fsm_step *step, char event_uid[65],
+void fsm_add_conditional_transition_to_step(struct fsm_step *step, char *event_uid,
                                             struct fsm_conditional_move (*fnct)(struct fsm_context *)) {
+    fsm_add_conditional_transition_to_step_id(step, fsm_registry_intern(event_uid), fnct);
+}
+
+void fsm_add_conditional_transition_to_step_id(struct fsm_step *step, fsm_event_id event_id,
+                                               struct fsm_conditional_move (*fnct)(struct fsm_context *)) {
     struct fsm_conditional_transition transition = {
+            .event_id = event_id,
             .fnct = fnct,
     };
-    // Copy the event's UID to the transition
-    strcpy(transition.event_uid, event_uid);
+    if (step->compiled != NULL){
+        log_warn("Adding a transition to a compiled step release the compiled graph");
+        fsm_graph_release();
+    }
     // Copy the transition to the conditional_transitions queue
     fsm_queue_push_back(step->conditional_transitions, (void *)&transition, sizeof(transition));
 }
@@ -341,62 +933,480 @@ struct fsm_pointer *fsm_create_pointer()
 {
     struct fsm_config_pointer default_config = {
         .ttl_activated = false,
+        .lockfree_input = false,
+        .input_capacity = 0,
+        .input_overflow_policy = FSM_RING_BLOCK,
+        .wait_spin = 0,
+        .wait_yield = 0,
+        .executor = NULL,
+        .synchronous = false,
+        .timer_wheel = NULL,
     };
     return fsm_create_pointer_config(default_config);
 }
 
+/*! Get the timer wheel signaling the delayed events of a pointer
+ */
+static struct fsm_timer_wheel *_fsm_pointer_get_wheel(struct fsm_pointer *pointer) {
+    return pointer->config.timer_wheel != NULL ? pointer->config.timer_wheel : fsm_timer_wheel_default();
+}
+
+/*! Signal a pointer from a timer wheel callback, which must never block
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param event Pointer to the fsm_event
+ *      @param policy Policy used by a bounded input, anything but FSM_RING_BLOCK
+ *
+ *  @retval false if the bounded input is full and refused the event, the caller still owns it
+ *  @retval true otherwise
+ */
+static bool _fsm_signal_pointer_from_wheel(struct fsm_pointer *pointer, struct fsm_event *event,
+                                           unsigned short policy) {
+    if (pointer->input_ring == NULL){
+        fsm_signal_pointer_of_event(pointer, event);
+        return true;
+    }
+    return _fsm_push_ring_event(pointer, event, policy) != FSM_ERR_INPUT_FULL;
+}
+
+/*! Arm a timer again at the next tick of its wheel, the input of its pointer being full
+ */
+static void _fsm_timer_retry(struct fsm_timer_wheel *wheel, struct fsm_timer *timer) {
+    struct timespec retry = fsm_time_get_abs_fixed_time_from_us(wheel->tick_us);
+    fsm_timer_arm(wheel, timer, &retry);
+}
+
+static void _fsm_time_add_us(struct timespec *ts, unsigned int delta_us) {
+    ts->tv_sec += delta_us / 1000000;
+    ts->tv_nsec += 1000 * (long)(delta_us % 1000000);
+    if (ts->tv_nsec >= FSM_TIME_NANO_SECONDE){
+        ts->tv_sec++;
+        ts->tv_nsec -= FSM_TIME_NANO_SECONDE;
+    }
+}
+
+/*! Remove a fsm_event_timer from the event_timers of its pointer, the timers_mutex must be held
+ */
+static void _fsm_event_timer_unlink(struct fsm_event_timer *event_timer) {
+    *event_timer->pprev = event_timer->next;
+    if (event_timer->next != NULL){
+        event_timer->next->pprev = event_timer->pprev;
+    }
+    event_timer->pprev = NULL;
+}
+
+/*! Called by the timer wheel of a pointer when the timeout of its step is reached
+ *      @param timer Pointer to the step_timer of the fsm_pointer
+ *  */
+static void _fsm_pointer_timer_expired(struct fsm_timer *timer) {
+    struct fsm_pointer *pointer = (struct fsm_pointer *)((char *) timer - offsetof(struct fsm_pointer, step_timer));
+    struct fsm_event *event = fsm_generate_event_id(_EVENT_TIMER_ID, NULL);
+    if (!_fsm_signal_pointer_from_wheel(pointer, event, FSM_RING_FAIL)){
+        fsm_event_release(event);
+        _fsm_timer_retry(pointer->config.timer_wheel, timer);
+    }
+}
+
+/*! Called by the timer wheel when a delayed or periodic event have to be signaled
+ *      @param timer Pointer to the timer of the fsm_event_timer
+ *  */
+static void _fsm_event_timer_expired(struct fsm_timer *timer) {
+    struct fsm_event_timer *event_timer = (struct fsm_event_timer *) timer;
+    struct fsm_pointer *pointer = event_timer->pointer;
+    struct fsm_timer_wheel *wheel = _fsm_pointer_get_wheel(pointer);
+    unsigned short policy = pointer->config.input_overflow_policy == FSM_RING_BLOCK ?
+                            FSM_RING_FAIL : pointer->config.input_overflow_policy;
+    struct fsm_event *event = event_timer->period_us > 0 ?
+                              fsm_generate_event_id(event_timer->event_id, event_timer->args) : event_timer->event;
+    if (!_fsm_signal_pointer_from_wheel(pointer, event, policy)){
+        if (event_timer->period_us > 0){
+            fsm_event_release(event);
+        }
+        _fsm_timer_retry(wheel, timer);
+        return;
+    }
+    event_timer->event = NULL;
+    pthread_mutex_lock(&pointer->timers_mutex);
+    if (event_timer->pprev == NULL){
+        // Taken back by a cancel or a join, which frees it once this callback returned
+        pthread_mutex_unlock(&pointer->timers_mutex);
+        return;
+    }
+    if (event_timer->period_us > 0){
+        while (!fsm_time_check_absolute_time(event_timer->deadline)){
+            // Skip the periods already elapsed
+            _fsm_time_add_us(&event_timer->deadline, event_timer->period_us);
+        }
+        fsm_timer_arm(wheel, timer, &event_timer->deadline);
+        pthread_mutex_unlock(&pointer->timers_mutex);
+        return;
+    }
+    _fsm_event_timer_unlink(event_timer);
+    pthread_mutex_unlock(&pointer->timers_mutex);
+    free(event_timer);
+}
+
+/*! Create a fsm_event_timer and arm it
+ */
+static struct fsm_event_timer *_fsm_create_event_timer(struct fsm_pointer *pointer, struct fsm_event *event,
+                                                       fsm_event_id event_id, void *args,
+                                                       unsigned int delay_us, unsigned int period_us) {
+    struct fsm_event_timer *event_timer = malloc(sizeof(struct fsm_event_timer));
+    check_mem(event_timer);
+    fsm_timer_init(&event_timer->timer, _fsm_event_timer_expired);
+    event_timer->pointer = pointer;
+    event_timer->event = event;
+    event_timer->event_id = event_id;
+    event_timer->args = args;
+    event_timer->period_us = period_us;
+    event_timer->deadline = fsm_time_get_abs_fixed_time_from_us(0);
+    _fsm_time_add_us(&event_timer->deadline, delay_us);
+    pthread_mutex_lock(&pointer->timers_mutex);
+    event_timer->next = pointer->event_timers;
+    if (event_timer->next != NULL){
+        event_timer->next->pprev = &event_timer->next;
+    }
+    pointer->event_timers = event_timer;
+    event_timer->pprev = &pointer->event_timers;
+    // Armed under the mutex, so a join can't miss it
+    fsm_timer_arm(_fsm_pointer_get_wheel(pointer), &event_timer->timer, &event_timer->deadline);
+    pthread_mutex_unlock(&pointer->timers_mutex);
+    return event_timer;
+    error:
+    exit(1);
+}
+
 struct fsm_pointer *fsm_create_pointer_config(struct fsm_config_pointer config) {
-    struct fsm_pointer *pointer = malloc(sizeof(struct fsm_pointer));
+    // Aligned for its embedded stop event
+    struct fsm_pointer *pointer = aligned_alloc(_Alignof(struct fsm_pointer), sizeof(struct fsm_pointer));
+    check_mem(pointer);
     pointer->thread = 0;
-    // Init thread mutex and condition
+    // Init thread mutex and notifications
     pthread_mutex_init(&pointer->mutex, NULL);
-    pthread_condattr_t attr;
-
-    pthread_condattr_init(&attr);
-    int ret = 0;
-    ret = pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE);
-    check(ret == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK : ABORT, error %d", ret);
-    ret = pthread_cond_init(&pointer->cond_event, &attr);
-    check(ret == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK : ABORT, error %d", ret);
+    pointer->step_waiters = NULL;
+    fsm_notify_init(&pointer->input_notify);
+    pointer->input_spin.spin_max = config.wait_spin;
+    pointer->input_spin.spin = config.wait_spin;
+    pointer->input_spin.yield = config.wait_yield;
     //
     pointer->config = config;
-    pointer->input_event = create_fsm_queue();
+    if (config.synchronous && config.executor != NULL){
+        log_warn("A synchronous pointer is run by its caller, its executor is ignored");
+        pointer->config.executor = NULL;
+    }
+    pointer->input_event = create_fsm_queue_intrusive(offsetof(struct fsm_event, queue_elem));
+    // The pointer is woken up through input_notify, broadcasting the queue condition on every signal is useless
+    pointer->input_event.silent = 1;
+    fsm_mpsc_init(&pointer->input_mpsc);
+    pointer->input_pending = NULL;
+    if (config.input_capacity > 0){
+        pointer->input_ring = fsm_ring_create(config.input_capacity);
+    }else{
+        pointer->input_ring = NULL;
+    }
+    pointer->stop_requested = false;
     if(config.ttl_activated){
-        pointer->ttl_event = create_fsm_queue_pointer();
+        pointer->ttl_store = malloc(sizeof(struct fsm_ttl_store));
+        check_mem(pointer->ttl_store);
+        fsm_ttl_store_init(pointer->ttl_store);
     }else{
-        pointer->ttl_event = NULL;
+        pointer->ttl_store = NULL;
     }
     pointer->current_step = NULL;
+    pointer->timeout_armed = false;
+    fsm_timer_init(&pointer->step_timer, _fsm_pointer_timer_expired);
+    pthread_mutex_init(&pointer->timers_mutex, NULL);
+    pthread_mutex_init(&pointer->lanes_mutex, NULL);
+    pointer->lanes_mask = 0;
+    for (unsigned int lane = 0; lane < FSM_PRIORITY_LANES; lane++){
+        pointer->lanes_first[lane] = NULL;
+        pointer->lanes_last[lane] = NULL;
+    }
+    pointer->event_timers = NULL;
+    pointer->coalesce = NULL;
+    pointer->n_coalesce = 0;
+    memset(&pointer->stop_event, 0, sizeof(struct fsm_event));
+    pointer->stop_event.id = _EVENT_STOP_POINTER_ID;
+    pointer->stop_event.uid = _EVENT_STOP_POINTER_UID;
+    pointer->stop_event.preallocated = true;
     pointer->running = FSM_STATE_STOPPED;
+    pointer->exec_state = FSM_EXEC_IDLE;
+    pointer->exec_next = NULL;
+    pointer->exec_worker = 0;
+    pointer->exec_timed_index = FSM_EXEC_NOT_TIMED;
+    pointer->exec_run_timed = false;
+    pointer->poll_fd = NULL;
     return pointer;
 
     error:
-    log_err("CRITICAL MONOTONIC ISSUE");
     exit(1);
 }
 
 
+/*! Run a synchronous pointer in the calling thread until it has no event left
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param budget Maximum number of events to handle
+ *      @param handled Set to the number of events handled, can be \a NULL
+ *
+ *  @retval true if the pointer now waits for an event
+ *  @retval false if the pointer stopped
+ *  */
+static bool _fsm_pointer_run_synchronous(struct fsm_pointer *pointer, unsigned int budget, unsigned int *handled) {
+    const struct timespec *deadline;
+    int rc = _fsm_pointer_run(pointer, budget, &deadline, handled);
+    if (pointer->poll_fd != NULL){
+        if (rc == FSM_POINTER_RUN_AGAIN){
+            // Events left, the event loop has to come back
+            fsm_fd_signal(pointer->poll_fd);
+        }
+        fsm_fd_set_timer(pointer->poll_fd, deadline);
+    }
+    if (rc != FSM_POINTER_RUN_DONE){
+        return true;
+    }
+    pthread_mutex_lock(&pointer->mutex);
+    __atomic_store_n(&pointer->running, FSM_STATE_STOPPED, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&pointer->mutex);
+    return false;
+}
+
+/*! Check if a pointer has started its first step, the pointer mutex must be held
+ */
+static bool _fsm_pointer_is_started(struct fsm_pointer *pointer, struct fsm_step_waiter *waiter) {
+    return __atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) != FSM_STATE_STARTING;
+}
+
 unsigned short fsm_start_pointer(struct fsm_pointer *pointer, struct fsm_step *init_step) {
     pthread_mutex_lock(&pointer->mutex);
-    if ( pointer->running != FSM_STATE_STOPPED ) {
+    if (__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) != FSM_STATE_STOPPED) {
         log_err("A pointer can't be started if it's not stopped");
+        pthread_mutex_unlock(&pointer->mutex);
         return FSM_ERR_NOT_STOPPED;
     }
     pointer->current_step = init_step;
-    pointer->running = FSM_STATE_STARTING;
-    pthread_create(&(pointer->thread), NULL, &fsm_pointer_loop, (void *) pointer);
-    // Waiting for the pointer to start his first step
-    while(pointer->running == FSM_STATE_STARTING){
-        pthread_cond_wait(&pointer->cond_event, &pointer->mutex);
+    // A joined pointer refuses the events of its bounded input until it's started again, nobody would empty it
+    __atomic_store_n(&pointer->stop_requested, false, __ATOMIC_RELEASE);
+    __atomic_store_n(&pointer->running, FSM_STATE_STARTING, __ATOMIC_RELEASE);
+    if (pointer->config.synchronous){
+        // The first step is run right now by the caller
+        pthread_mutex_unlock(&pointer->mutex);
+        _fsm_pointer_run_synchronous(pointer, UINT_MAX, NULL);
+        return 0;
+    }
+    if (pointer->config.executor != NULL){
+        // The first step is run by a worker of the executor
+        _fsm_executor_start(pointer);
+    }else{
+        pthread_create(&(pointer->thread), NULL, &fsm_pointer_loop, (void *) pointer);
     }
     pthread_mutex_unlock(&pointer->mutex);
+    // Waiting for the pointer to start his first step
+    struct fsm_step_waiter waiter = { .step = NULL, .leave = 0 };
+    _fsm_pointer_wait(pointer, &waiter, _fsm_pointer_is_started, NULL);
     return 0;
 }
 
 
 
-void fsm_signal_pointer_of_event(struct fsm_pointer *pointer, struct fsm_event *event) {
-    _fsm_push_back_event_queue(&pointer->input_event, event);
+int fsm_signal_pointer_of_event(struct fsm_pointer *pointer, struct fsm_event *event) {
+    if (event->priority > 0){
+        _fsm_push_lane_event(pointer, event);
+        return 0;
+    }
+    if (pointer->input_ring != NULL){
+        if (__atomic_load_n(&pointer->stop_requested, __ATOMIC_ACQUIRE)){
+            // Being joined : refused so the ring can be emptied, it would never be handled anyway
+            fsm_event_release(event);
+            return FSM_ERR_EVENT_DROPPED;
+        }
+        return _fsm_push_ring_event(pointer, event, pointer->config.input_overflow_policy);
+    }
+    if (pointer->config.lockfree_input){
+        _fsm_push_mpsc_event(pointer, event);
+    }else if (event->id < pointer->n_coalesce && pointer->coalesce[event->id].enabled){
+        _fsm_push_coalesced_event(pointer, event);
+    }else{
+        _fsm_push_back_event_queue(&pointer->input_event, event);
+        _fsm_wake_pointer(pointer);
+    }
+    return 0;
+}
+
+unsigned int fsm_signal_pointer_of_events(struct fsm_pointer *pointer, struct fsm_event **events, unsigned int n) {
+    if (n == 0){
+        return 0;
+    }
+    for (unsigned int i = 0; i < n; i++){
+        if (events[i]->priority > 0){
+            // Urgent events skip the batch, so signal them one by one in order
+            unsigned int taken = 0;
+            while (taken < n && fsm_signal_pointer_of_event(pointer, events[taken]) != FSM_ERR_INPUT_FULL){
+                taken++;
+            }
+            return taken;
+        }
+    }
+    if (pointer->input_ring != NULL){
+        if (__atomic_load_n(&pointer->stop_requested, __ATOMIC_ACQUIRE)){
+            for (unsigned int i = 0; i < n; i++){
+                fsm_event_release(events[i]);
+            }
+            return n;
+        }
+        if ((pointer->config.executor != NULL || pointer->config.synchronous) &&
+                pointer->config.input_overflow_policy == FSM_RING_BLOCK){
+            // The pointer must be scheduled before a wait for room, so push the events one by one
+            unsigned int i = 0;
+            while (i < n && _fsm_push_ring_event(pointer, events[i], FSM_RING_BLOCK) == 0){
+                i++;
+            }
+            return i;
+        }
+        unsigned int taken = fsm_ring_push_batch(pointer->input_ring, (void **) events, n,
+                                                 pointer->config.input_overflow_policy,
+                                                 (void (*)(void *)) fsm_event_release);
+        if (taken > 0 && (pointer->config.executor != NULL || pointer->config.synchronous)){
+            _fsm_wake_pointer(pointer);
+        }
+        return taken;
+    }
+    if (pointer->config.lockfree_input){
+        _fsm_push_mpsc_events(pointer, events, n);
+    }else if (pointer->n_coalesce > 0){
+        // Each event may replace a pending one, so signal them one by one
+        for (unsigned int i = 0; i < n; i++){
+            fsm_signal_pointer_of_event(pointer, events[i]);
+        }
+    }else{
+        fsm_queue_push_back_batch(&pointer->input_event, (void **) events, n);
+        _fsm_wake_pointer(pointer);
+    }
+    return n;
+}
+
+void fsm_pointer_coalesce(struct fsm_pointer *pointer, fsm_event_id event_id) {
+    if (event_id >= pointer->n_coalesce){
+        struct fsm_coalesce_slot *coalesce = realloc(pointer->coalesce, (event_id + 1) * sizeof(struct fsm_coalesce_slot));
+        check_mem(coalesce);
+        memset(coalesce + pointer->n_coalesce, 0, (event_id + 1 - pointer->n_coalesce) * sizeof(struct fsm_coalesce_slot));
+        pointer->coalesce = coalesce;
+        pointer->n_coalesce = event_id + 1;
+    }
+    pointer->coalesce[event_id].enabled = true;
+    return;
+    error:
+    exit(1);
+}
+
+void fsm_signal_pointer_of_event_after(struct fsm_pointer *pointer, struct fsm_event *event, unsigned int delay_us) {
+    _fsm_create_event_timer(pointer, event, event->id, NULL, delay_us, 0);
+}
+
+struct fsm_event_timer *fsm_signal_pointer_of_event_every(struct fsm_pointer *pointer, fsm_event_id event_id,
+                                                          void *args, unsigned int period_us) {
+    check(period_us > 0, "A periodic event must have a period greater than 0");
+    return _fsm_create_event_timer(pointer, NULL, event_id, args, period_us, period_us);
+    error:
+    exit(1);
+}
+
+void fsm_cancel_event_timer(struct fsm_event_timer *timer) {
+    struct fsm_pointer *pointer = timer->pointer;
+    pthread_mutex_lock(&pointer->timers_mutex);
+    if (timer->pprev == NULL){
+        log_warn("Asking to cancel a fsm_event_timer already cancelled");
+        pthread_mutex_unlock(&pointer->timers_mutex);
+        return;
+    }
+    _fsm_event_timer_unlink(timer);
+    pthread_mutex_unlock(&pointer->timers_mutex);
+    fsm_timer_cancel_sync(_fsm_pointer_get_wheel(pointer), &timer->timer);
+    free(timer);
+}
+
+int fsm_pointer_dispatch(struct fsm_pointer *pointer, struct fsm_event *event) {
+    if (!pointer->config.synchronous){
+        log_err("Only a synchronous pointer can handle an event in the calling thread");
+        if (event != NULL){
+            fsm_event_release(event);
+        }
+        return FSM_ERR_NOT_SYNCHRONOUS;
+    }
+    if (__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) != FSM_STATE_RUNNING){
+        if (event != NULL){
+            fsm_event_release(event);
+        }
+        return FSM_ERR_NOT_RUNNING;
+    }
+    if (event != NULL && !_fsm_pointer_handle_event(pointer, event)){
+        // The stop event have been dispatched
+        _fsm_pointer_exit(pointer);
+        pthread_mutex_lock(&pointer->mutex);
+        __atomic_store_n(&pointer->running, FSM_STATE_STOPPED, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&pointer->mutex);
+        return 0;
+    }
+    // Then the events signaled meanwhile, by the callbacks for example
+    _fsm_pointer_run_synchronous(pointer, UINT_MAX, NULL);
+    return 0;
+}
+
+int fsm_pointer_get_fd(struct fsm_pointer *pointer) {
+    if (!pointer->config.synchronous){
+        log_err("Only a synchronous pointer can be polled");
+        return -1;
+    }
+    pthread_mutex_lock(&pointer->mutex);
+    if (pointer->poll_fd == NULL){
+        struct fsm_fd *fd = malloc(sizeof(struct fsm_fd));
+        check_mem(fd);
+        if (fsm_fd_open(fd) != 0){
+            log_err("Impossible to create the file descriptor of the pointer");
+            free(fd);
+            pthread_mutex_unlock(&pointer->mutex);
+            return -1;
+        }
+        // Events could have been signaled before, let the event loop check
+        fsm_fd_signal(fd);
+        __atomic_store_n(&pointer->poll_fd, fd, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&pointer->mutex);
+    return pointer->poll_fd->poll_fd;
+
+    error:
+    exit(1);
+}
+
+unsigned int fsm_pointer_run_ready(struct fsm_pointer *pointer, unsigned int max_events) {
+    unsigned int handled = 0;
+    if (!pointer->config.synchronous){
+        log_err("Only a synchronous pointer can be run by the caller");
+        return 0;
+    }
+    if (pointer->poll_fd != NULL){
+        fsm_fd_clear(pointer->poll_fd);
+    }
+    if (__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) == FSM_STATE_RUNNING){
+        _fsm_pointer_run_synchronous(pointer, max_events, &handled);
+    }
+    return handled;
+}
+
+struct fsm_input_stats fsm_pointer_get_input_stats(struct fsm_pointer *pointer) {
+    struct fsm_input_stats stats = {
+            .capacity = 0,
+            .pending = 0,
+            .high_water = 0,
+            .dropped = 0,
+    };
+    if (pointer->input_ring != NULL){
+        pthread_mutex_lock(&pointer->input_ring->mutex);
+        stats.capacity = pointer->input_ring->capacity;
+        stats.pending = pointer->input_ring->count;
+        stats.high_water = pointer->input_ring->high_water;
+        stats.dropped = pointer->input_ring->dropped;
+        pthread_mutex_unlock(&pointer->input_ring->mutex);
+    }
+    return stats;
 }
 
 void fsm_delete_pointer(struct fsm_pointer *pointer) {
@@ -405,18 +1415,64 @@ void fsm_delete_pointer(struct fsm_pointer *pointer) {
 //        return FSM_ERR_NULL_POINTER;
 //    }
     fsm_join_pointer(pointer);
+    if (pointer->input_ring != NULL){
+        fsm_ring_delete(pointer->input_ring, (void (*)(void *)) fsm_event_release);
+    }
+    fsm_notify_destroy(&pointer->input_notify);
+    pthread_mutex_destroy(&pointer->timers_mutex);
+    pthread_mutex_destroy(&pointer->lanes_mutex);
+    free(pointer->coalesce);
+    if (pointer->poll_fd != NULL){
+        fsm_fd_close(pointer->poll_fd);
+        free(pointer->poll_fd);
+    }
     free(pointer);
 }
 
 struct fsm_event *fsm_generate_event(char *event_uid, void *args) {
-    struct fsm_event *event = malloc(sizeof(struct fsm_event));
-    // Copy the given event UID to the new allocated event
-    strcpy(event->uid, event_uid);
+    return fsm_generate_event_id(fsm_registry_intern(event_uid), args);
+}
+
+struct fsm_event *fsm_generate_event_id(fsm_event_id event_id, void *args) {
+    struct fsm_event *event = fsm_event_acquire();
+    event->id = event_id;
+    // The UID is not copied, the event refer to the one interned by the registry
+    event->uid = fsm_registry_uid(event_id);
     event->args = args;
     return event;
 }
 
+struct fsm_event *fsm_generate_event_payload(fsm_event_id event_id, const void *payload, unsigned int size) {
+    check(size <= FSM_EVENT_PAYLOAD_SIZE, "A payload of %u bytes doesn't fit into an event", size);
+    struct fsm_event *event = fsm_generate_event_id(event_id, NULL);
+    memcpy(event->payload, payload, size);
+    event->payload_size = (unsigned char) size;
+    return event;
+    error:
+    exit(1);
+}
+
+void *fsm_event_get_payload(struct fsm_event *event, unsigned int *size) {
+    if (event->shared != NULL){
+        // A delivery doesn't copy the payload of the published event
+        event = event->shared;
+    }
+    if (size != NULL){
+        *size = event->payload_size;
+    }
+    return event->payload_size > 0 ? event->payload : NULL;
+}
+
+fsm_event_id fsm_event_register(const char *event_uid) {
+    return fsm_registry_intern(event_uid);
+}
+
+const char *fsm_event_get_uid(fsm_event_id event_id) {
+    return fsm_registry_uid(event_id);
+}
+
 void fsm_delete_all_steps() {
+    fsm_graph_release();
     while(_all_steps_created->first != NULL){
         struct fsm_step *step = (struct fsm_step *) fsm_queue_pop_front(_all_steps_created);
         _fsm_delete_a_step(step);
@@ -431,21 +1487,76 @@ void fsm_join_pointer(struct fsm_pointer *pointer) {
         return;
     }
     pthread_mutex_lock(&pointer->mutex);
-    if(pointer->running == FSM_STATE_RUNNING) {
+    if(__atomic_load_n(&pointer->running, __ATOMIC_ACQUIRE) == FSM_STATE_RUNNING) {
         // Add signal to close in the pointer input_event queue
-        fsm_signal_pointer_of_event(pointer, fsm_generate_event(_EVENT_STOP_POINTER_UID, NULL));
+        if (pointer->input_ring != NULL){
+            // Never pushed into the ring : it could be full, or evicted by a DROP_OLDEST producer.
+            // The pointer stops once its ring is empty, and new events are refused so it gets empty
+            __atomic_store_n(&pointer->stop_requested, true, __ATOMIC_SEQ_CST);
+            if (pointer->config.executor == NULL && !pointer->config.synchronous){
+                fsm_ring_kick(pointer->input_ring);
+            }else{
+                _fsm_wake_pointer(pointer);
+            }
+        }else{
+            fsm_signal_pointer_of_event(pointer, &pointer->stop_event);
+        }
         // Set pointer running step to closing in case the pointer do not watch his transitions (because of a direct loop for example)
-        pointer->running = FSM_STATE_CLOSING;
+        __atomic_store_n(&pointer->running, FSM_STATE_CLOSING, __ATOMIC_RELEASE);
         pthread_mutex_unlock(&pointer->mutex);
-        pthread_join(pointer->thread, NULL);
+        if (pointer->config.synchronous){
+            // Handle the events signaled before the stop one, like the pointer thread does
+            _fsm_pointer_run_synchronous(pointer, UINT_MAX, NULL);
+        }else if (pointer->config.executor != NULL){
+            _fsm_executor_join(pointer);
+        }else{
+            pthread_join(pointer->thread, NULL);
+        }
         pthread_mutex_lock(&pointer->mutex);
-        pointer->running = FSM_STATE_STOPPED;
+        __atomic_store_n(&pointer->running, FSM_STATE_STOPPED, __ATOMIC_RELEASE);
+    }
+    if (pointer->config.timer_wheel != NULL){
+        // The timer must not fire once the pointer is freed, nor signal it after the cleanup
+        fsm_timer_cancel_sync(pointer->config.timer_wheel, &pointer->step_timer);
+        pointer->timeout_armed = false;
+    }
+    struct fsm_event *event;
+    // Delayed events not signaled yet are dropped with the pending ones
+    pthread_mutex_lock(&pointer->timers_mutex);
+    struct fsm_event_timer *event_timer = pointer->event_timers;
+    pointer->event_timers = NULL;
+    for (struct fsm_event_timer *it = event_timer; it != NULL; it = it->next){
+        it->pprev = NULL;
+    }
+    pthread_mutex_unlock(&pointer->timers_mutex);
+    while (event_timer != NULL){
+        struct fsm_event_timer *next = event_timer->next;
+        fsm_timer_cancel_sync(_fsm_pointer_get_wheel(pointer), &event_timer->timer);
+        if (event_timer->event != NULL){
+            fsm_event_release(event_timer->event);
+        }
+        free(event_timer);
+        event_timer = next;
+    }
+    fsm_queue_cleanup_more(&pointer->input_event, (void (*)(void *)) fsm_event_release);
+    pthread_mutex_lock(&pointer->input_event.mutex);
+    _fsm_forget_coalesced_events(pointer);
+    pthread_mutex_unlock(&pointer->input_event.mutex);
+    _fsm_release_pending_events(pointer);
+    while ((event = _fsm_pop_lane_event(pointer)) != NULL){
+        fsm_event_release(event);
     }
-    fsm_queue_cleanup(&pointer->input_event);
-    if (pointer->ttl_event != NULL){
-        fsm_queue_cleanup(pointer->ttl_event);
-        free(pointer->ttl_event);
-        pointer->ttl_event = NULL;
+    struct fsm_mpsc_node *node;
+    while ((node = fsm_mpsc_pop(&pointer->input_mpsc)) != NULL){
+        fsm_event_release(_fsm_event_of_mpsc_node(node));
+    }
+    while (pointer->input_ring != NULL && (event = fsm_ring_pop(pointer->input_ring)) != NULL){
+        fsm_event_release(event);
+    }
+    if (pointer->ttl_store != NULL){
+        fsm_ttl_store_cleanup(pointer->ttl_store);
+        free(pointer->ttl_store);
+        pointer->ttl_store = NULL;
     }
     pthread_mutex_unlock(&pointer->mutex);
 }
@@ -454,29 +1565,76 @@ void *fsm_null_callback(struct fsm_context *context) {
     return NULL;
 }
 
-int _fsm_wait_step_mstimeout(struct fsm_pointer *pointer, struct fsm_step *step, unsigned int mstimeout, char leave) {
-    struct timespec ts = fsm_time_get_abs_fixed_time_from_us(mstimeout*1000);
-    int rc = 0;
+/*! Check if the current step of a pointer is the one of the waiter, or isn't it anymore according to its leave value
+ */
+static bool _fsm_step_is_reached(struct fsm_pointer *pointer, struct fsm_step_waiter *waiter) {
+    return (__atomic_load_n(&pointer->current_step, __ATOMIC_SEQ_CST) == waiter->step) == (waiter->leave == 0);
+}
 
-    pthread_mutex_lock(&pointer->input_event.mutex);
-    // Wait that the given step become the current one or the opposite according to the leave value
-    while ( (pointer->current_step == step && leave == 1) || (pointer->current_step != step && leave == 0) ){
-        rc = pthread_cond_timedwait(&pointer->cond_event, &pointer->input_event.mutex, &ts);
+void _fsm_wake_step_waiters(struct fsm_pointer *pointer) {
+    for (struct fsm_step_waiter *waiter = pointer->step_waiters; waiter != NULL; waiter = waiter->next){
+        if (waiter->step == NULL || _fsm_step_is_reached(pointer, waiter)){
+            fsm_notify_wake(&waiter->notify);
+        }
+    }
+}
+
+int _fsm_pointer_wait(struct fsm_pointer *pointer, struct fsm_step_waiter *waiter,
+                      bool (*is_done)(struct fsm_pointer *, struct fsm_step_waiter *), const struct timespec *abstime) {
+    pthread_mutex_lock(&pointer->mutex);
+    if (is_done(pointer, waiter)){
+        pthread_mutex_unlock(&pointer->mutex);
+        return 0;
+    }
+    fsm_notify_init(&waiter->notify);
+    waiter->next = pointer->step_waiters;
+    if (waiter->next != NULL){
+        waiter->next->pprev = &waiter->next;
+    }
+    waiter->pprev = &pointer->step_waiters;
+    // The pointer thread sets its step then reads the waiters without the mutex, the condition is checked again
+    // below after the waiter is published : one of both sees the other
+    __atomic_store_n(&pointer->step_waiters, waiter, __ATOMIC_SEQ_CST);
+    int rc = 0;
+    while (!is_done(pointer, waiter)){
+        // The key is taken under the mutex, so a wake up between the unlock and the wait isn't lost
+        unsigned int key = fsm_notify_prepare(&waiter->notify);
+        pthread_mutex_unlock(&pointer->mutex);
+        rc = fsm_notify_wait(&waiter->notify, key, abstime);
+        pthread_mutex_lock(&pointer->mutex);
         if (rc == ETIMEDOUT){
+            rc = is_done(pointer, waiter) ? 0 : ETIMEDOUT;
             break;
         }
     }
-    pthread_mutex_unlock(&pointer->input_event.mutex);
+    __atomic_store_n(waiter->pprev, waiter->next, __ATOMIC_RELAXED);
+    if (waiter->next != NULL){
+        waiter->next->pprev = waiter->pprev;
+    }
+    // Wake ups are done under the mutex, nobody uses the notification anymore
+    pthread_mutex_unlock(&pointer->mutex);
+    fsm_notify_destroy(&waiter->notify);
     return rc;
 }
 
+/*! Wait that the given step become the current one or the opposite according to the leave value
+ *      @param abstime Absolute monotonic time to wait until, \a NULL to wait forever
+ *
+ *  @retval 0 if the step is reached
+ *  @retval ETIMEDOUT otherwise
+ */
+int _fsm_wait_step(struct fsm_pointer *pointer, struct fsm_step *step, char leave, const struct timespec *abstime) {
+    struct fsm_step_waiter waiter = { .step = step, .leave = leave };
+    return _fsm_pointer_wait(pointer, &waiter, _fsm_step_is_reached, abstime);
+}
+
+int _fsm_wait_step_mstimeout(struct fsm_pointer *pointer, struct fsm_step *step, unsigned int mstimeout, char leave) {
+    struct timespec ts = fsm_time_get_abs_fixed_time_from_us(mstimeout*1000);
+    return _fsm_wait_step(pointer, step, leave, &ts);
+}
+
 int _fsm_wait_step_blocking(struct fsm_pointer *pointer, struct fsm_step *step, char leave) {
-    pthread_mutex_lock(&pointer->mutex);
-    // Wait that the given step become the current one or the opposite according to the leave value
-    while ( (pointer->current_step == step && leave == 1) || (pointer->current_step != step && leave == 0) ){
-        pthread_cond_wait(&pointer->cond_event, &pointer->mutex);
-    }
-    pthread_mutex_unlock(&pointer->mutex);
+    return _fsm_wait_step(pointer, step, leave, NULL);
 }
 
 
@@ -498,6 +1656,8 @@ int fsm_wait_leaving_step_mstimeout(struct fsm_pointer *pointer, struct fsm_step
 
 void fsm_delete_a_step(fsm_step *step) {
     if(fsm_queue_get_elem(_all_steps_created, step) != NULL){
+        // Other compiled steps could refer to this one
+        fsm_graph_release();
         // We are sure that the step exist and we've removed it from _all_created_steps
         // Now we can delete it safely
         _fsm_delete_a_step(step);
@@ -523,3 +1683,118 @@ struct fsm_conditional_move fsm_cond_return_conditional_transition(
     result.move = (void *)fnct;
     return result;
 }
+
+/*! Add a transition to a compiled step if its event_id isn't already used by the step
+ *      @param compiled Pointer to the fsm_compiled_step, its transitions must be the last ones added to the graph
+ *      @param graph Pointer to the fsm_graph being compiled
+ *      @param transition Transition to add
+ *
+ *  The first transition added for an event_id wins, as in the dynamic way where the first transition found is used
+ *  and transitions are looked before conditional transitions.
+ *  */
+void _fsm_graph_add_transition(struct fsm_compiled_step *compiled, struct fsm_graph *graph,
+                               struct fsm_compiled_transition transition) {
+    for (unsigned int i = 0; i < compiled->n_transitions; i++){
+        if (compiled->transitions[i].event_id == transition.event_id){
+            return;
+        }
+    }
+    compiled->transitions[compiled->n_transitions] = transition;
+    compiled->n_transitions++;
+    graph->n_transitions++;
+}
+
+int _fsm_graph_compare_transitions(const void *a, const void *b) {
+    fsm_event_id id_a = ((struct fsm_compiled_transition *) a)->event_id;
+    fsm_event_id id_b = ((struct fsm_compiled_transition *) b)->event_id;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+void fsm_graph_compile() {
+    fsm_graph_release();
+    if (_all_steps_created == NULL){
+        return;
+    }
+    struct fsm_graph *graph = malloc(sizeof(struct fsm_graph));
+    check_mem(graph);
+    pthread_mutex_lock(&_all_steps_created->mutex);
+    // First count steps and transitions to allocate the arrays only once
+    unsigned int n_steps = 0;
+    unsigned int n_transitions = 0;
+    struct fsm_queue_elem *cursor, *trans_cursor;
+    for (cursor = _all_steps_created->first; cursor != NULL; cursor = cursor->next){
+        struct fsm_step *step = cursor->value;
+        n_steps++;
+        for (trans_cursor = step->transitions->first; trans_cursor != NULL; trans_cursor = trans_cursor->next){
+            n_transitions++;
+        }
+        for (trans_cursor = step->conditional_transitions->first; trans_cursor != NULL; trans_cursor = trans_cursor->next){
+            n_transitions++;
+        }
+    }
+    graph->n_steps = n_steps;
+    graph->n_transitions = 0;
+    // One more element so an empty graph still get valid arrays
+    graph->steps = malloc((n_steps + 1) * sizeof(struct fsm_compiled_step));
+    graph->transitions = malloc((n_transitions + 1) * sizeof(struct fsm_compiled_transition));
+    check_mem(graph->steps && graph->transitions);
+    // Then pack every step transitions one after the other
+    n_steps = 0;
+    for (cursor = _all_steps_created->first; cursor != NULL; cursor = cursor->next){
+        struct fsm_step *step = cursor->value;
+        struct fsm_compiled_step *compiled = &graph->steps[n_steps];
+        compiled->direct_step = NULL;
+        compiled->transitions = &graph->transitions[graph->n_transitions];
+        compiled->n_transitions = 0;
+        for (trans_cursor = step->transitions->first; trans_cursor != NULL; trans_cursor = trans_cursor->next){
+            struct fsm_transition *transition = trans_cursor->value;
+            struct fsm_compiled_transition compiled_transition = {
+                    .event_id = transition->event_id,
+                    .next_step = transition->next_step,
+                    .fnct = NULL,
+            };
+            if (trans_cursor == step->transitions->first && transition->event_id == _EVENT_DIRECT_TRANSITION_ID){
+                compiled->direct_step = transition->next_step;
+            }
+            _fsm_graph_add_transition(compiled, graph, compiled_transition);
+        }
+        for (trans_cursor = step->conditional_transitions->first; trans_cursor != NULL; trans_cursor = trans_cursor->next){
+            struct fsm_conditional_transition *transition = trans_cursor->value;
+            struct fsm_compiled_transition compiled_transition = {
+                    .event_id = transition->event_id,
+                    .next_step = NULL,
+                    .fnct = transition->fnct,
+            };
+            _fsm_graph_add_transition(compiled, graph, compiled_transition);
+        }
+        qsort(compiled->transitions, compiled->n_transitions, sizeof(struct fsm_compiled_transition),
+              _fsm_graph_compare_transitions);
+        step->id = n_steps;
+        step->compiled = compiled;
+        n_steps++;
+    }
+    pthread_mutex_unlock(&_all_steps_created->mutex);
+    _compiled_graph = graph;
+    return;
+
+    error:
+    log_err("Impossible to allocate the compiled graph");
+    exit(1);
+}
+
+void fsm_graph_release() {
+    if (_compiled_graph == NULL){
+        return;
+    }
+    if (_all_steps_created != NULL){
+        pthread_mutex_lock(&_all_steps_created->mutex);
+        for (struct fsm_queue_elem *cursor = _all_steps_created->first; cursor != NULL; cursor = cursor->next){
+            ((struct fsm_step *) cursor->value)->compiled = NULL;
+        }
+        pthread_mutex_unlock(&_all_steps_created->mutex);
+    }
+    free(_compiled_graph->steps);
+    free(_compiled_graph->transitions);
+    free(_compiled_graph);
+    _compiled_graph = NULL;
+}
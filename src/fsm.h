@@ -39,11 +39,20 @@
 
 #include <time.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <bits/time.h>
 
 #include "pthread.h"
 #include "fsm_time.h"
 #include "fsm_queue.h"
+#include "fsm_mpsc.h"
+#include "fsm_ring.h"
+#include "fsm_notify.h"
+#include "fsm_executor.h"
+#include "fsm_fd.h"
+#include "fsm_timer.h"
+#include "fsm_ttl.h"
+#include "fsm_bus.h"
 
 
 #define MAX_EVENT_UID_LEN 65
@@ -52,6 +61,15 @@
 #define _EVENT_START_POINTER_UID "__START_POINTER"
 #define _EVENT_OUT_ACTION_UID "__OUT_ACTION"
 #define _EVENT_TIMEOUT_UID "__TIMEOUT"
+#define _EVENT_TIMER_UID "__TIMER"
+
+// IDs reserved for the system events, given in this order by the event registry
+#define _EVENT_STOP_POINTER_ID 1
+#define _EVENT_DIRECT_TRANSITION_ID 2
+#define _EVENT_START_POINTER_ID 3
+#define _EVENT_OUT_ACTION_ID 4
+#define _EVENT_TIMEOUT_ID 5
+#define _EVENT_TIMER_ID 6               // Sent by a timer wheel, turned into a timeout event if it isn't stale
 
 #define FSM_STATE_STOPPED  0
 #define FSM_STATE_RUNNING  1
@@ -59,16 +77,44 @@
 #define FSM_STATE_CLOSING  3
 
 #define FSM_ERR_NOT_STOPPED 1
+#define FSM_ERR_INPUT_FULL 2
+#define FSM_ERR_EVENT_DROPPED 3
+#define FSM_ERR_NOT_SYNCHRONOUS 4
+#define FSM_ERR_NOT_RUNNING 5
+
+#define FSM_CACHE_LINE_SIZE 64     // Events are aligned on it, so the payload is read with the event ID
+#define FSM_EVENT_PAYLOAD_SIZE 48  // Maximum size of the payload copied into an event, see fsm_generate_event_payload
+#define FSM_PRIORITY_LANES 4    // Input lanes of a pointer, an event priority of FSM_PRIORITY_LANES - 1 or more is the most urgent
 
 
+typedef unsigned int fsm_event_id;
 
 struct fsm_event
 {
-    char uid[MAX_EVENT_UID_LEN];
-    struct timespec ttl;
+    // First cache line : what a step reads to handle the event, with its payload
+    _Alignas(FSM_CACHE_LINE_SIZE) fsm_event_id id;
+    unsigned char priority;     // Input lane, 0 for the normal input, higher ones are handled first
+    bool preallocated;          // System event owned by the library or a pointer, never given back to the event pool
+    unsigned char payload_size; // Bytes used into payload, 0 if the event has no payload
     void * args;
+    _Alignas(max_align_t) unsigned char payload[FSM_EVENT_PAYLOAD_SIZE];   // Small arguments copied into the event
+    // Next cache lines : name, TTL, bus and links, only used by the mechanisms which ask for them
+    const char * uid;
+    struct timespec ttl;
+    void (*args_free)(void *);  // Called on args when the event is released, NULL to leave them to the caller
+    struct fsm_event * shared;  // Published event this one is a delivery of, see fsm_bus_publish
+    unsigned int refs;          // Deliveries of a published event not released yet
+    struct fsm_event * next;    // Intrusive link, used by the event pool when the event is free
+    struct fsm_event * ttl_prev;    // Intrusive link into a bucket of the fsm_ttl_store, with next
+    unsigned long ttl_seq;          // Arrival number into the fsm_ttl_store
+    unsigned int ttl_index;         // Index into the heap of the fsm_ttl_store
+    struct fsm_mpsc_node mpsc_node; // Intrusive link, used by lock free input queues
+    struct fsm_queue_elem queue_elem;   // Intrusive link, used by the input_event fsm_queue
 };
 
+_Static_assert(offsetof(struct fsm_event, payload) + FSM_EVENT_PAYLOAD_SIZE <= FSM_CACHE_LINE_SIZE,
+               "The payload must fit into the first cache line of an event, with its ID and args");
+
 struct fsm_context{
     struct fsm_event * event;
     struct fsm_pointer *pointer;
@@ -76,13 +122,15 @@ struct fsm_context{
 };
 
 struct fsm_transition {
-    char event_uid[MAX_EVENT_UID_LEN];
+    fsm_event_id event_id;
     struct fsm_step *next_step;
+    struct fsm_queue_elem queue_elem;   // Intrusive link into the transitions fsm_queue of the step
 };
 
 struct fsm_conditional_transition {
-    char event_uid[MAX_EVENT_UID_LEN];
+    fsm_event_id event_id;
     struct fsm_conditional_move (*fnct)(struct fsm_context *);
+    struct fsm_queue_elem queue_elem;   // Intrusive link into the conditional_transitions fsm_queue of the step
 };
 
 struct fsm_conditional_move {
@@ -90,6 +138,25 @@ struct fsm_conditional_move {
     void *move;
 };
 
+struct fsm_compiled_transition {
+    fsm_event_id event_id;
+    struct fsm_step *next_step;
+    struct fsm_conditional_move (*fnct)(struct fsm_context *); // NULL if it isn't a conditional transition
+};
+
+struct fsm_compiled_step {
+    struct fsm_step *direct_step;   // Next step if the step starts with a direct transition, NULL otherwise
+    struct fsm_compiled_transition *transitions;    // Sorted by event_id, one transition per event_id
+    unsigned int n_transitions;
+};
+
+struct fsm_graph {
+    unsigned int n_steps;
+    struct fsm_compiled_step *steps;    // Indexed by step id
+    unsigned int n_transitions;
+    struct fsm_compiled_transition *transitions;
+};
+
 struct fsm_step{
     void * (*fnct)(struct fsm_context *);
     void * args;
@@ -97,23 +164,91 @@ struct fsm_step{
     struct fsm_queue * conditional_transitions;
     void * (*out_fnct)(struct fsm_context *);
     void * out_args;
-    struct timespec timeout;
     int timeout_us;
+    unsigned int id;
+    struct fsm_compiled_step * compiled;
+    struct fsm_queue_elem queue_elem;   // Intrusive link into the fsm_queue of all created steps
 };
 
 struct fsm_config_pointer {
     bool ttl_activated;
+    bool lockfree_input;    // Signaled events go through a lock free queue instead of the input_event fsm_queue
+    unsigned int input_capacity;    // Maximum number of pending events, 0 for no limit
+    unsigned short input_overflow_policy;   // What to do when input_capacity is reached, one of the FSM_RING_* policies
+    unsigned int wait_spin;     // Maximum number of pause iterations polling the input before yielding, 0 to never spin
+    unsigned int wait_yield;    // Number of sched_yield polling the input before sleeping
+    struct fsm_executor * executor; // Worker pool running the pointer, NULL to run it on its own thread
+    bool synchronous;           // No thread at all, events are handled by fsm_pointer_dispatch in the caller thread
+    struct fsm_timer_wheel * timer_wheel;   // Wheel owning the step timeouts, NULL to have the pointer wait for them
+};
+
+struct fsm_input_stats {
+    unsigned int capacity;
+    unsigned int pending;
+    unsigned int high_water;    // Maximum number of pending events reached
+    unsigned long dropped;      // Number of events dropped by the overflow policy
+};
+
+struct fsm_event_timer {
+    struct fsm_timer timer;
+    struct fsm_event_timer * next;
+    struct fsm_event_timer ** pprev;    // Link into the event_timers of the pointer, NULL once taken back by a cancel or a join
+    struct fsm_pointer * pointer;
+    struct fsm_event * event;           // Event of a one shot timer, NULL once signaled
+    fsm_event_id event_id;              // Event generated at each period of a periodic timer
+    void * args;
+    unsigned int period_us;             // 0 for a one shot timer
+    struct timespec deadline;           // Time of the next signal, periods are counted from it to avoid any drift
+};
+
+struct fsm_step_waiter {
+    struct fsm_step * step;     // Step waited for, NULL to be woken up by every change of the pointer
+    char leave;                 // Wait for the pointer to leave the step instead of reaching it
+    struct fsm_notify notify;
+    struct fsm_step_waiter * next;
+    struct fsm_step_waiter ** pprev;
+};
+
+struct fsm_coalesce_slot {
+    bool enabled;                   // Events of this ID are coalesced
+    struct fsm_event * pending;     // Event of this ID into the input_event fsm_queue, NULL if there is none
 };
 
 struct fsm_pointer{
     pthread_t thread;
     pthread_mutex_t mutex;
-    pthread_cond_t cond_event;
+    struct fsm_step_waiter * step_waiters;  // Threads waiting for a change of the pointer, linked under the mutex
     struct fsm_config_pointer config;
     struct fsm_queue input_event;
-    struct fsm_queue * ttl_event;
-    struct fsm_step * current_step;
-    unsigned short running;
+    struct fsm_mpsc_queue input_mpsc;
+    struct fsm_notify input_notify; // Woken up when an event is pushed into input_event or input_mpsc
+    struct fsm_notify_spin input_spin;  // How the pointer thread waits on input_notify
+    struct fsm_ring * input_ring;   // Bounded input queue, NULL if input_capacity is 0
+    bool stop_requested;            // Joined while it has a bounded input : it stops once the input is empty, read atomically
+    struct fsm_event * input_pending;   // Events taken from the input but not handled yet, only used by the pointer thread
+    struct fsm_ttl_store * ttl_store;   // Events kept by the TTL mechanism, NULL if it isn't activated
+    struct fsm_step * current_step;     // Only set by the pointer thread, read atomically by the others
+    struct timespec step_timeout;   // Absolute time of the timeout of the current step
+    bool timeout_armed;             // The current step have a timeout which isn't raised yet
+    struct fsm_timer step_timer;    // Timer of the current step into the timer wheel, if the pointer uses one
+    unsigned short running;             // One of the FSM_STATE_* states, read atomically
+    unsigned int exec_state;        // One of the FSM_EXEC_* states, only used with an executor
+    struct fsm_pointer * exec_next; // Link into the run queue of a worker of the executor
+    unsigned int exec_worker;       // Index of the worker which last ran the pointer, it's queued back on it
+    unsigned int exec_timed_index;  // Index into the deadline heap of the executor, FSM_EXEC_NOT_TIMED if not in it
+    struct timespec exec_deadline;  // Timeout the executor waits for, with exec_timed_index under the executor mutex
+    bool exec_run_timed;            // The last run registered exec_run_deadline, only used by the worker running it
+    struct timespec exec_run_deadline;
+    struct fsm_fd * poll_fd;        // Pollable file descriptor of a synchronous pointer, NULL until asked for
+    pthread_mutex_t lanes_mutex;
+    unsigned int lanes_mask;        // Bit set for each priority lane holding events, the lane 0 is the normal input
+    struct fsm_event * lanes_first[FSM_PRIORITY_LANES];
+    struct fsm_event * lanes_last[FSM_PRIORITY_LANES];
+    pthread_mutex_t timers_mutex;   // Protect event_timers, never held while waiting for a timer callback
+    struct fsm_event_timer * event_timers;  // Delayed and periodic events not signaled yet
+    struct fsm_coalesce_slot * coalesce;    // Indexed by event ID, protected by the input_event mutex
+    struct fsm_event stop_event;    // Signaled by fsm_join_pointer, preallocated so a join never allocates
+    unsigned int n_coalesce;
 };
 
 typedef struct fsm_pointer fsm_pointer;
@@ -121,6 +256,7 @@ typedef struct fsm_step fsm_step;
 typedef struct fsm_event fsm_event;
 typedef struct fsm_transition fsm_transition;
 typedef struct fsm_context fsm_context;
+typedef struct fsm_event_timer fsm_event_timer;
 
 
 /*! Create a pointer. Don't start it, just init variables
@@ -143,6 +279,39 @@ struct fsm_pointer *fsm_create_pointer();
  *
  *  @return Pointer to the new created fsm_pointer
  *
+ *  Available options :
+ *   - \c ttl_activated : events which can't trigger a transition are kept until their \c ttl and tried again on each new step
+ *   - \c lockfree_input : signaled events go through a lock free multi producers queue. Producers never take a lock
+ *     and the pointer thread only sleeps on a condition when there is no event at all. Useful when a lot of threads
+ *     signal the same pointer.
+ *   - \c input_capacity : if not 0, signaled events are stored into a preallocated ring buffer of this size
+ *     instead of an unbounded queue. It takes precedence over \c lockfree_input.
+ *   - \c input_overflow_policy : what fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*) does when the ring buffer is full :
+ *       - \c FSM_RING_BLOCK : wait for the pointer to make room (default)
+ *       - \c FSM_RING_DROP_NEWEST : release the signaled event
+ *       - \c FSM_RING_DROP_OLDEST : release the oldest pending event to make room
+ *       - \c FSM_RING_FAIL : refuse the event, the caller keeps it
+ *   - \c wait_spin and \c wait_yield : when there is no event, the pointer thread busy-polls its input up to
+ *     \c wait_spin pause iterations, then yields \c wait_yield times, before sleeping. The spin length adapts itself
+ *     between a few iterations and \c wait_spin according to how often events come while spinning. It trades CPU for
+ *     a much faster reaction to events, and producers don't have to wake up a sleeping thread. Not used with a bounded
+ *     input, an executor or a synchronous pointer.
+ *   - \c executor : the pointer has no thread, it's run by the workers of this fsm_executor when it has events or
+ *     when the timeout of its step is due. Thousands of mostly idle pointers can share a few workers.
+ *   - \c synchronous : the pointer has no thread and no executor, its events are handled in the caller thread by
+ *     fsm_pointer_dispatch(fsm_pointer*,fsm_event*) or fsm_pointer_run_ready(fsm_pointer*,unsigned int). It takes
+ *     precedence over \c executor, which is ignored with a warning.
+ *   - \c timer_wheel : the step timeouts are armed into this fsm_timer_wheel, which signals them as events, instead of
+ *     being waited for by the pointer. With an executor, the timeouts are then never tracked by the executor : the
+ *     pointer is only scheduled when the wheel signals it, at the wheel tick precision. With a synchronous pointer,
+ *     the timeout event makes its file descriptor readable like any other event.
+ *
+ *  A bounded input with the \c FSM_RING_BLOCK policy is allowed with an executor or a synchronous pointer, but a
+ *  producer waiting for room blocks its own thread : a callback must never signal its own full pointer, as it would
+ *  block the worker (or the caller of a synchronous pointer) which is the only one able to make room. For a
+ *  synchronous pointer, room is only made when the application runs it, so the producers must not be the thread
+ *  running it. Timers of a wheel never block, they retry on the next tick when the input is full.
+ *
  *  @note It uses \c malloc for the fsm_pointer allocation : you should free it at the end of his usage
  *  @note The fsm_delete_pointer(fsm_pointer*) function help you to free the pointer correctly
  *
@@ -223,6 +392,17 @@ struct fsm_step *fsm_create_step(void *(*fnct)(struct fsm_context *), void *args
  */
 void fsm_connect_step(struct fsm_step *from, struct fsm_step *to, char *event_uid);
 
+/*! Connect two step with an event ID by creating a transition.
+ *      @param from Transition start point.
+ *      @param to Transition end point.
+ *      @param event_id ID of the event linking start point to end point, as returned by fsm_event_register(const char*)
+ *
+ * Same as fsm_connect_step(fsm_step*,fsm_step*,char*) without the UID lookup.
+ *
+ * @see fsm_connect_step(fsm_step*,fsm_step*,char*)
+ */
+void fsm_connect_step_id(struct fsm_step *from, struct fsm_step *to, fsm_event_id event_id);
+
 /*! Delete an unique step
  *      @param step Pointer to the fsm_step to delete
  *
@@ -236,14 +416,49 @@ void fsm_delete_a_step(fsm_step *step);
  */
 void fsm_delete_all_steps();
 
+/*! Freeze all steps created into a compiled graph
+ *
+ * Transitions and conditional transitions of every step are packed into contiguous arrays sorted by event ID.
+ * Running pointers then find the transition to trigger with a binary search into their current step
+ * instead of going through the locked fsm_queue of transitions.
+ *
+ * Each step is given an ID which is its index into the compiled graph.
+ *
+ * Example:
+ * @code{.c}
+ * fsm_connect_step(step_0, step_1, "GO");
+ * fsm_connect_step(step_1, step_0, "BACK");
+ * fsm_graph_compile();
+ *
+ * fsm_start_pointer(fsm, step_0);
+ * @endcode
+ *
+ * @note Steps created after this call aren't compiled, they still work the dynamic way
+ * @note Adding a transition to a compiled step or deleting a step release the compiled graph
+ *
+ * @warning Compiling or releasing the graph while a fsm_pointer is running is not safe
+ *
+ * @see fsm_graph_release()
+ */
+void fsm_graph_compile();
+
+/*! Release the compiled graph, steps go back to the dynamic way
+ *
+ * @note Safe if there is no compiled graph
+ * @note The graph is also released by fsm_delete_all_steps()
+ *
+ * @warning Releasing the graph while a fsm_pointer is running is not safe
+ */
+void fsm_graph_release();
+
 /*! Generate a fsm_event with the given UID and an optional generic void pointer as argument
  *      @param event_uid Event UID string
  *      @param args Generic void pointer to an argument, can be \a NULL
  *
  *  @return Pointer to the new generated fsm_event
  *
- *  @note It uses \c malloc for the fsm_event allocation : you should free it at the end of his usage
- *  @note The event is freed automatically by the fsm process if you directly put it in the input_event fsm_queue from a fsm_pointer with fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
+ *  @note The fsm_event comes from the event pool : you should release it with fsm_event_release(fsm_event*) at the end of his usage
+ *  @note The event is released automatically by the fsm process if you directly put it in the input_event fsm_queue from a fsm_pointer with fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
  *
  * Example:
  * @code{.c}
@@ -265,15 +480,260 @@ void fsm_delete_all_steps();
  */
 struct fsm_event *fsm_generate_event(char *event_uid, void *args);
 
+/*! Generate a fsm_event from an event ID and an optional generic void pointer as argument
+ *      @param event_id Event ID as returned by fsm_event_register(const char*)
+ *      @param args Generic void pointer to an argument, can be \a NULL
+ *
+ *  @return Pointer to the new generated fsm_event
+ *
+ *  Same as fsm_generate_event(char*,void*) without the UID lookup, it should be prefered for events signaled often.
+ *
+ *  @see fsm_generate_event(char*,void*)
+ */
+struct fsm_event *fsm_generate_event_id(fsm_event_id event_id, void *args);
+
+/*! Generate a fsm_event from an event ID carrying a copy of a small payload
+ *      @param event_id Event ID as returned by fsm_event_register(const char*)
+ *      @param payload Pointer to the bytes to copy into the event
+ *      @param size Size in bytes of the payload, at most \c FSM_EVENT_PAYLOAD_SIZE
+ *
+ *  @return Pointer to the new generated fsm_event
+ *
+ *  The payload is stored into the event itself, so a small message needs neither a second allocation nor an
+ *  \c args_free function. Steps read it with fsm_event_get_payload(fsm_event*,unsigned int*).
+ *
+ *  Example:
+ *  @code{.c}
+ *  struct position { int x; int y; } position = { 3, 4 };
+ *  fsm_signal_pointer_of_event(fsm, fsm_generate_event_payload(move_id, &position, sizeof(position)));
+ *  @endcode
+ *
+ *  @see fsm_generate_event_id(fsm_event_id,void*)
+ */
+struct fsm_event *fsm_generate_event_payload(fsm_event_id event_id, const void *payload, unsigned int size);
+
+/*! Get the payload carried by an event
+ *      @param event Pointer to the fsm_event
+ *      @param size Set to the size in bytes of the payload, can be \a NULL
+ *
+ *  @retval NULL if the event has no payload
+ *  @retval Pointer to the payload otherwise, valid until the event is released
+ *
+ *  A delivery of an event published with fsm_bus_publish(fsm_bus*,const char*,fsm_event*) gives the payload of the
+ *  published event.
+ */
+void *fsm_event_get_payload(struct fsm_event *event, unsigned int *size);
+
+/*! Get a blank fsm_event from the event pool
+ *
+ *  @return Pointer to a fsm_event with all its fields set to 0
+ *
+ *  Events are allocated by slabs and recycled : once the pool is warm, getting an event doesn't call \c malloc.
+ *  Each thread keeps its own cache of free events so this function usually takes no lock.
+ *
+ *  @note The event is released automatically by the fsm process if you put it in a fsm_pointer with fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
+ *
+ *  @see fsm_event_release(fsm_event*)
+ */
+struct fsm_event *fsm_event_acquire();
+
+/*! Give back an event to the event pool
+ *      @param event Pointer to the fsm_event to release, can be \a NULL
+ *
+ *  The \c args_free function of the event is called on its \c args. Releasing the last delivery of an event published
+ *  with fsm_bus_publish(fsm_bus*,const char*,fsm_event*) releases the published event too.
+ *
+ *  The system events given to the steps (start, out action, timeout and stop) are preallocated : releasing them does
+ *  nothing.
+ *
+ *  @warning Events from the pool must not be freed with \c free
+ *
+ *  @see fsm_event_acquire()
+ */
+void fsm_event_release(struct fsm_event *event);
+
+/*! Get the ID of an event UID, register it if it's the first time it's seen
+ *      @param event_uid Event UID string
+ *
+ *  @return The ID of the event
+ *
+ *  Transitions and events are matched by ID. Every function taking an UID string look for its ID once,
+ *  the \c _id variants allow to skip this lookup.
+ *
+ * Example:
+ * @code{.c}
+ * fsm_event_id go = fsm_event_register("GO");
+ *
+ * fsm_connect_step_id(step_0, step_1, go);
+ * fsm_signal_pointer_of_event(fsm, fsm_generate_event_id(go, NULL));
+ * @endcode
+ */
+fsm_event_id fsm_event_register(const char *event_uid);
+
+/*! Get the UID string of an event ID
+ *      @param event_id Event ID
+ *
+ *  @retval NULL if the ID is unknown
+ *  @retval The UID string otherwise
+ */
+const char *fsm_event_get_uid(fsm_event_id event_id);
+
 /*! Signal a fsm_pointer of an event
  *      @param pointer Pointer to the fsm_pointer concern by the event
  *      @param event Pointer to the event to signal
  *
- *  The given fsm_event is copied into the memory and store into the input_event fsm_queue of the given fsm_pointer. So you can't modify it after this.
+ *  @retval 0 if the event have been stored
+ *  @retval FSM_ERR_EVENT_DROPPED if the input is full and the event have been released because of the \c FSM_RING_DROP_NEWEST policy,
+ *  or if the input is bounded and the pointer is being joined or has been joined
+ *  @retval FSM_ERR_INPUT_FULL if the input is full and the event have been refused because of the \c FSM_RING_FAIL policy.
+ *  The caller still owns the event.
+ *
+ *  The given fsm_event is stored into the input of the given fsm_pointer. So you can't modify it after this.
+ *
+ *  An event with a \c priority greater than 0 goes into a priority lane instead, not bounded by \c input_capacity. The
+ *  pointer handles the events of its most urgent non empty lane first, before the ones already taken from its input.
+ *
+ *  @warning With a bounded input and the \c FSM_RING_BLOCK policy, a step must not signal its own full pointer
  *
  *  @see fsm_generate_event(char*,void*)
+ *  @see fsm_create_pointer_config(struct fsm_config_pointer)
+ */
+int fsm_signal_pointer_of_event(struct fsm_pointer *pointer, struct fsm_event *event);
+
+/*! Signal a fsm_pointer of several events at once
+ *      @param pointer Pointer to the fsm_pointer concern by the events
+ *      @param events Array of pointers to the events to signal, in order
+ *      @param n Number of events into the array
+ *
+ *  @return Number of events taken by the fsm_pointer, including the ones released by a \c FSM_RING_DROP_* policy or
+ *  because the pointer has a bounded input and is being joined or has been joined.
+ *  With the \c FSM_RING_FAIL policy the events after this index have been refused and the caller still owns them.
+ *
+ *  Same as calling fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*) for each event, but the input is locked
+ *  (or the lock free queue exchanged) once and the fsm_pointer is woken up once for the whole batch.
+ *
+ *  @see fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
+ */
+unsigned int fsm_signal_pointer_of_events(struct fsm_pointer *pointer, struct fsm_event **events, unsigned int n);
+
+/*! Coalesce the events of an ID signaled to a fsm_pointer
+ *      @param pointer Pointer to the fsm_pointer, not started yet
+ *      @param event_id ID of the events to coalesce
+ *
+ *  While an event of this ID waits into the input of the pointer, a new one doesn't queue up behind it : its \c args,
+ *  \c args_free, payload and \c ttl replace the pending ones, which are released with the new event. The pointer only
+ *  sees the latest state, at the place of the first pending event. Useful for status or progress updates, when a slow
+ *  pointer must not handle every intermediate value.
+ *
+ *  @note Only the default input is coalesced : events go through unchanged with \c lockfree_input, \c input_capacity
+ *  or a \c priority greater than 0.
+ *
+ *  @see fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
  */
-void fsm_signal_pointer_of_event(struct fsm_pointer *pointer, struct fsm_event *event);
+void fsm_pointer_coalesce(struct fsm_pointer *pointer, fsm_event_id event_id);
+
+/*! Signal a fsm_pointer of an event once a delay is elapsed
+ *      @param pointer Pointer to the fsm_pointer concern by the event
+ *      @param event Pointer to the event to signal
+ *      @param delay_us Delay in microseconds
+ *
+ *  The event is signaled by the timer wheel of the pointer, or the one given by fsm_timer_wheel_default() if it has
+ *  none, so no thread is created per delayed event. A bounded input with the \c FSM_RING_BLOCK policy is never waited
+ *  for : if it's full the event is signaled again at the next tick of the wheel.
+ *
+ *  Events not signaled yet when the fsm_pointer is joined are released.
+ *
+ *  @see fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*)
+ */
+void fsm_signal_pointer_of_event_after(struct fsm_pointer *pointer, struct fsm_event *event, unsigned int delay_us);
+
+/*! Signal a fsm_pointer of a new event at each period
+ *      @param pointer Pointer to the fsm_pointer concern by the events
+ *      @param event_id ID of the events to generate
+ *      @param args Arguments of the events to generate, shared by all of them
+ *      @param period_us Period in microseconds, greater than 0
+ *
+ *  @return Pointer to the fsm_event_timer, to give to fsm_cancel_event_timer(fsm_event_timer*)
+ *
+ *  Periods are counted from the first deadline, so a late signal doesn't delay the next ones. The periods missed
+ *  because the wheel thread or the input of the pointer were late are skipped.
+ *
+ *  @warning The fsm_event_timer is cancelled and freed when the fsm_pointer is joined
+ */
+struct fsm_event_timer *fsm_signal_pointer_of_event_every(struct fsm_pointer *pointer, fsm_event_id event_id,
+                                                          void *args, unsigned int period_us);
+
+/*! Stop and free a periodic fsm_event_timer
+ *      @param timer Pointer to the fsm_event_timer
+ *
+ *  No event is signaled by the timer once the function returns.
+ *
+ *  @warning Must not be called once the fsm_pointer is joined, nor from a step callback run by the timer wheel thread
+ */
+void fsm_cancel_event_timer(struct fsm_event_timer *timer);
+
+/*! Handle an event in the calling thread, run to completion
+ *      @param pointer Pointer to a started fsm_pointer created with the \c synchronous config
+ *      @param event Pointer to the event to handle, \a NULL to only handle the events signaled to the pointer
+ *
+ *  @retval 0 if the event have been handled
+ *  @retval FSM_ERR_NOT_SYNCHRONOUS if the pointer isn't a synchronous one
+ *  @retval FSM_ERR_NOT_RUNNING if the pointer isn't started
+ *
+ *  The transition triggered by the event, the out action and the callback of the step reached, then the direct
+ *  transitions and the steps returned by callbacks are run before the function returns, exactly as the pointer thread
+ *  would do. Then the events signaled to the pointer with fsm_signal_pointer_of_event(fsm_pointer*,fsm_event*) (by
+ *  its callbacks for example) are handled the same way, and the timeout of the current step if it's due.
+ *
+ *  The event is released in any case.
+ *
+ *  @note A synchronous pointer is started by fsm_start_pointer(fsm_pointer*,fsm_step*), which runs the first step in
+ *  the calling thread, and stopped by fsm_join_pointer(fsm_pointer*) or by dispatching the stop event.
+ *  @warning Only one thread at a time can dispatch events to a pointer
+ *
+ *  @see fsm_create_pointer_config(struct fsm_config_pointer)
+ */
+int fsm_pointer_dispatch(struct fsm_pointer *pointer, struct fsm_event *event);
+
+/*! Get a file descriptor which becomes readable when a synchronous pointer has work to do
+ *      @param pointer Pointer to a fsm_pointer created with the \c synchronous config
+ *
+ *  @retval -1 if the pointer isn't a synchronous one or the file descriptor can't be created
+ *  @retval A file descriptor to add to a poll, select or epoll set otherwise
+ *
+ *  The file descriptor is readable when events have been signaled to the pointer or when the timeout of its current
+ *  step is reached. fsm_pointer_run_ready(fsm_pointer*,unsigned int) must then be called, it handles this work
+ *  without blocking. It's created by the first call, readable at once, and closed by fsm_delete_pointer(fsm_pointer*).
+ *
+ *  Example :
+ *  @code{.c}
+ *  struct epoll_event ev = { .events = EPOLLIN, .data.ptr = fsm };
+ *  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fsm_pointer_get_fd(fsm), &ev);
+ *  // Into the event loop, once epoll_wait returned ev
+ *  fsm_pointer_run_ready(ev.data.ptr, 64);
+ *  @endcode
+ *
+ *  @warning Only available on Linux
+ */
+int fsm_pointer_get_fd(struct fsm_pointer *pointer);
+
+/*! Handle the events signaled to a synchronous pointer and its due timeout without blocking
+ *      @param pointer Pointer to a started fsm_pointer created with the \c synchronous config
+ *      @param max_events Maximum number of events to handle, so a busy pointer can't starve the event loop
+ *
+ *  @return Number of events handled. The file descriptor of the pointer stays readable if there are events left.
+ *
+ *  @see fsm_pointer_get_fd(fsm_pointer*)
+ *  @see fsm_pointer_dispatch(fsm_pointer*,fsm_event*)
+ */
+unsigned int fsm_pointer_run_ready(struct fsm_pointer *pointer, unsigned int max_events);
+
+/*! Get statistics about the bounded input of a fsm_pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @return A fsm_input_stats, all set to 0 if the pointer input is not bounded
+ */
+struct fsm_input_stats fsm_pointer_get_input_stats(struct fsm_pointer *pointer);
 
 /*! Wait the given pointer to reach the given step in the given timeout interval
  *      @param pointer Pointer to the fsm_pointer to wait
@@ -350,7 +810,16 @@ void fsm_set_timeout_to_step(struct fsm_step *step, int timeout_us);
  *
  *  If the given event_uid appears, the fnct is called with the actual context. If the function return NULL, the fsm do not change his current step. Otherwise, the fsm jump to the step returned by the function.
  */
-void fsm_add_conditional_transition_to_step(struct fsm_step *step, char event_uid[MAX_EVENT_UID_LEN], struct fsm_conditional_move (*fnct)(struct fsm_context *));
+void fsm_add_conditional_transition_to_step(struct fsm_step *step, char *event_uid, struct fsm_conditional_move (*fnct)(struct fsm_context *));
+
+/*! Add a conditional transition triggered by an event ID to the given step
+ *      @param step Pointer to the step
+ *      @param event_id ID of the event which triggered the conditional transition
+ *      @param fnct Function of the conditional transition
+ *
+ *  @see fsm_add_conditional_transition_to_step(fsm_step*,char*,fnct)
+ */
+void fsm_add_conditional_transition_to_step_id(struct fsm_step *step, fsm_event_id event_id, struct fsm_conditional_move (*fnct)(struct fsm_context *));
 
 struct fsm_conditional_move fsm_cond_return_step(fsm_step * step);
 
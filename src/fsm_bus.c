@@ -0,0 +1,109 @@
+//
+// Publish / subscribe bus of events
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fsm_debug.h"
+#include "fsm.h"
+#include "fsm_registry.h"
+#include "fsm_bus.h"
+
+#define _FSM_BUS_INIT_CAPACITY 16
+
+struct fsm_bus *fsm_bus_create() {
+    struct fsm_bus *bus = malloc(sizeof(struct fsm_bus));
+    check_mem(bus);
+    check(pthread_rwlock_init(&bus->lock, NULL) == 0, "ERROR DURING RWLOCK INIT");
+    bus->topics = NULL;
+    bus->n_topics = 0;
+    return bus;
+    error:
+    exit(1);
+}
+
+void fsm_bus_delete(struct fsm_bus *bus) {
+    for (unsigned int i = 0; i < bus->n_topics; i++){
+        free(bus->topics[i].subscribers);
+    }
+    free(bus->topics);
+    pthread_rwlock_destroy(&bus->lock);
+    free(bus);
+}
+
+void fsm_bus_subscribe(struct fsm_bus *bus, const char *topic, struct fsm_pointer *pointer) {
+    unsigned int id = fsm_registry_intern(topic);
+    pthread_rwlock_wrlock(&bus->lock);
+    if (id >= bus->n_topics){
+        unsigned int n_topics = bus->n_topics > 0 ? bus->n_topics : _FSM_BUS_INIT_CAPACITY;
+        while (n_topics <= id){
+            n_topics *= 2;
+        }
+        struct fsm_bus_topic *topics = realloc(bus->topics, n_topics * sizeof(struct fsm_bus_topic));
+        check_mem(topics);
+        memset(topics + bus->n_topics, 0, (n_topics - bus->n_topics) * sizeof(struct fsm_bus_topic));
+        bus->topics = topics;
+        bus->n_topics = n_topics;
+    }
+    struct fsm_bus_topic *bus_topic = &bus->topics[id];
+    if (bus_topic->count == bus_topic->capacity){
+        unsigned int capacity = bus_topic->capacity > 0 ? 2 * bus_topic->capacity : _FSM_BUS_INIT_CAPACITY;
+        struct fsm_pointer **subscribers = realloc(bus_topic->subscribers, capacity * sizeof(struct fsm_pointer *));
+        check_mem(subscribers);
+        bus_topic->subscribers = subscribers;
+        bus_topic->capacity = capacity;
+    }
+    bus_topic->subscribers[bus_topic->count++] = pointer;
+    pthread_rwlock_unlock(&bus->lock);
+    return;
+    error:
+    exit(1);
+}
+
+void fsm_bus_unsubscribe(struct fsm_bus *bus, const char *topic, struct fsm_pointer *pointer) {
+    unsigned int id = fsm_registry_find(topic);
+    pthread_rwlock_wrlock(&bus->lock);
+    if (id != 0 && id < bus->n_topics){
+        struct fsm_bus_topic *bus_topic = &bus->topics[id];
+        for (unsigned int i = 0; i < bus_topic->count; i++){
+            if (bus_topic->subscribers[i] == pointer){
+                // The order of the subscribers doesn't matter
+                bus_topic->subscribers[i] = bus_topic->subscribers[--bus_topic->count];
+                break;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&bus->lock);
+}
+
+unsigned int fsm_bus_publish(struct fsm_bus *bus, const char *topic, struct fsm_event *event) {
+    unsigned int id = fsm_registry_find(topic);
+    unsigned int delivered = 0;
+    // The publisher holds a reference until every delivery is signaled
+    __atomic_store_n(&event->refs, 1, __ATOMIC_RELAXED);
+    pthread_rwlock_rdlock(&bus->lock);
+    if (id != 0 && id < bus->n_topics){
+        struct fsm_bus_topic *bus_topic = &bus->topics[id];
+        for (unsigned int i = 0; i < bus_topic->count; i++){
+            struct fsm_event *delivery = fsm_event_acquire();
+            delivery->id = event->id;
+            delivery->uid = event->uid;
+            delivery->ttl = event->ttl;
+            delivery->priority = event->priority;
+            delivery->args = event->args;
+            delivery->shared = event;
+            __atomic_add_fetch(&event->refs, 1, __ATOMIC_RELAXED);
+            if (fsm_signal_pointer_of_event(bus_topic->subscribers[i], delivery) == FSM_ERR_INPUT_FULL){
+                fsm_event_release(delivery);
+            }else{
+                delivered++;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&bus->lock);
+    if (__atomic_sub_fetch(&event->refs, 1, __ATOMIC_ACQ_REL) == 0){
+        fsm_event_release(event);
+    }
+    return delivered;
+}
@@ -0,0 +1,77 @@
+/*!
+ * \file fsm_bus.h
+ * \brief Publish an event to every fsm_pointer subscribed to a topic
+ *
+ * A published event is never copied : each subscriber is given a delivery, a small event taken from the event pool
+ * which shares the ID, UID, ttl and \c args of the published one. The published event is kept until its last delivery
+ * is released, then its \c args_free function is called if there is one, so the \c args can be shared safely.
+ *
+ * Topics are interned by the event registry, the same string always gives the same topic.
+ */
+
+#ifndef FSM_BUS_H
+#define FSM_BUS_H
+
+#include "pthread.h"
+
+struct fsm_pointer;
+struct fsm_event;
+
+struct fsm_bus_topic {
+    struct fsm_pointer ** subscribers;
+    unsigned int count;
+    unsigned int capacity;
+};
+
+struct fsm_bus {
+    pthread_rwlock_t lock;          // Held for reading while publishing, for writing while subscribing
+    struct fsm_bus_topic * topics;  // Indexed by the registry ID of the topic
+    unsigned int n_topics;
+};
+
+typedef struct fsm_bus fsm_bus;
+
+/*! Create an empty fsm_bus
+ *
+ *  @return Pointer to the new fsm_bus
+ *
+ *  @see fsm_bus_delete(fsm_bus*)
+ */
+struct fsm_bus *fsm_bus_create();
+
+/*! Free a fsm_bus and its subscriptions
+ *      @param bus Pointer to the fsm_bus
+ */
+void fsm_bus_delete(struct fsm_bus *bus);
+
+/*! Subscribe a fsm_pointer to a topic
+ *      @param bus Pointer to the fsm_bus
+ *      @param topic Topic string
+ *      @param pointer Pointer to the fsm_pointer, which receives the events published to the topic
+ *
+ *  @warning The fsm_pointer must be unsubscribed before it's deleted
+ */
+void fsm_bus_subscribe(struct fsm_bus *bus, const char *topic, struct fsm_pointer *pointer);
+
+/*! Unsubscribe a fsm_pointer from a topic, nothing is done if it isn't subscribed
+ *      @param bus Pointer to the fsm_bus
+ *      @param topic Topic string
+ *      @param pointer Pointer to the fsm_pointer
+ */
+void fsm_bus_unsubscribe(struct fsm_bus *bus, const char *topic, struct fsm_pointer *pointer);
+
+/*! Signal an event to every fsm_pointer subscribed to a topic
+ *      @param bus Pointer to the fsm_bus
+ *      @param topic Topic string
+ *      @param event Pointer to the fsm_event, owned by the bus
+ *
+ *  @return Number of fsm_pointer which have taken a delivery of the event
+ *
+ *  Deliveries follow the input policy of each pointer : one refused by a full bounded input with the \c FSM_RING_FAIL
+ *  policy isn't counted.
+ *
+ *  @warning With a bounded input and the \c FSM_RING_BLOCK policy, a full subscriber blocks the whole publish
+ */
+unsigned int fsm_bus_publish(struct fsm_bus *bus, const char *topic, struct fsm_event *event);
+
+#endif //FSM_BUS_H
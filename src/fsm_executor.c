@@ -0,0 +1,442 @@
+//
+// Fixed pool of worker threads running many fsm_pointer
+//
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "fsm.h"
+#include "fsm_debug.h"
+#include "fsm_executor.h"
+
+#define _FSM_EXECUTOR_INIT_TIMED 16
+
+/*! Wake up an idle worker if any, because a pointer have been queued or a timeout is earlier
+ *      @param executor Pointer to the fsm_executor
+ *      @param locked The executor mutex is held by the caller
+ */
+static void _fsm_executor_wake(struct fsm_executor *executor, bool locked) {
+    // Order the queueing before the read of idle_workers, see _fsm_executor_worker
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&executor->idle_workers, __ATOMIC_RELAXED) == 0){
+        return;
+    }
+    if (!locked){
+        pthread_mutex_lock(&executor->mutex);
+    }
+    pthread_cond_signal(&executor->cond);
+    if (!locked){
+        pthread_mutex_unlock(&executor->mutex);
+    }
+}
+
+/*! Append a pointer to the run queue of a worker
+ */
+static void _fsm_executor_push(struct fsm_executor_worker *worker, struct fsm_pointer *pointer) {
+    pointer->exec_next = NULL;
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->last == NULL){
+        worker->first = pointer;
+    }else{
+        worker->last->exec_next = pointer;
+    }
+    worker->last = pointer;
+    __atomic_add_fetch(&worker->count, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&worker->mutex);
+}
+
+/*! Remove the first pointer of the run queue of a worker
+ *
+ *  @retval NULL if the run queue is empty
+ */
+static struct fsm_pointer *_fsm_executor_pop(struct fsm_executor_worker *worker) {
+    if (__atomic_load_n(&worker->count, __ATOMIC_ACQUIRE) == 0){
+        return NULL;
+    }
+    pthread_mutex_lock(&worker->mutex);
+    struct fsm_pointer *pointer = worker->first;
+    if (pointer != NULL){
+        worker->first = pointer->exec_next;
+        if (worker->first == NULL){
+            worker->last = NULL;
+        }
+        __atomic_sub_fetch(&worker->count, 1, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&worker->mutex);
+    return pointer;
+}
+
+/*! Take half of the run queue of an other worker, the oldest pointers first
+ *      @param worker Pointer to the fsm_executor_worker stealing, the pointers after the first one go to its run queue
+ *      @param victim Pointer to the fsm_executor_worker robbed
+ *
+ *  @retval NULL if the run queue of the victim is empty
+ *  @retval The first pointer stolen, to run at once
+ */
+static struct fsm_pointer *_fsm_executor_steal(struct fsm_executor_worker *worker, struct fsm_executor_worker *victim) {
+    if (__atomic_load_n(&victim->count, __ATOMIC_ACQUIRE) == 0){
+        return NULL;
+    }
+    pthread_mutex_lock(&victim->mutex);
+    unsigned int n = (victim->count + 1) / 2;
+    struct fsm_pointer *first = victim->first;
+    struct fsm_pointer *last = first;
+    for (unsigned int i = 1; i < n; i++){
+        last = last->exec_next;
+    }
+    if (first != NULL){
+        victim->first = last->exec_next;
+        if (victim->first == NULL){
+            victim->last = NULL;
+        }
+        __atomic_sub_fetch(&victim->count, n, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&victim->mutex);
+    if (first == NULL || first == last){
+        return first;
+    }
+    // Keep the first one to run, the other ones are now queued on the thief
+    last->exec_next = NULL;
+    pthread_mutex_lock(&worker->mutex);
+    if (worker->last == NULL){
+        worker->first = first->exec_next;
+    }else{
+        worker->last->exec_next = first->exec_next;
+    }
+    worker->last = last;
+    __atomic_add_fetch(&worker->count, n - 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&worker->mutex);
+    return first;
+}
+
+/*! Take the next pointer to run for a worker, from its own run queue or stolen from an other worker
+ *
+ *  @retval NULL if no pointer is ready
+ */
+static struct fsm_pointer *_fsm_executor_take(struct fsm_executor_worker *worker) {
+    struct fsm_executor *executor = worker->executor;
+    struct fsm_pointer *pointer = _fsm_executor_pop(worker);
+    for (unsigned int i = 1; pointer == NULL && i < executor->n_workers; i++){
+        pointer = _fsm_executor_steal(worker, &executor->workers[(worker->index + i) % executor->n_workers]);
+    }
+    return pointer;
+}
+
+/*! Check if a pointer is queued on any worker
+ */
+static bool _fsm_executor_has_ready(struct fsm_executor *executor) {
+    for (unsigned int i = 0; i < executor->n_workers; i++){
+        if (__atomic_load_n(&executor->workers[i].count, __ATOMIC_SEQ_CST) > 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool _fsm_executor_before(struct fsm_pointer *a, struct fsm_pointer *b) {
+    return fsm_time_delta_ns64(a->exec_deadline, b->exec_deadline) > 0;
+}
+
+static void _fsm_executor_heap_set(struct fsm_executor *executor, unsigned int index, struct fsm_pointer *pointer) {
+    executor->timed[index] = pointer;
+    pointer->exec_timed_index = index;
+}
+
+static void _fsm_executor_heap_up(struct fsm_executor *executor, unsigned int index) {
+    struct fsm_pointer *pointer = executor->timed[index];
+    while (index > 0 && _fsm_executor_before(pointer, executor->timed[(index - 1) / 2])){
+        _fsm_executor_heap_set(executor, index, executor->timed[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    _fsm_executor_heap_set(executor, index, pointer);
+}
+
+static void _fsm_executor_heap_down(struct fsm_executor *executor, unsigned int index) {
+    struct fsm_pointer *pointer = executor->timed[index];
+    while (2 * index + 1 < executor->n_timed){
+        unsigned int child = 2 * index + 1;
+        if (child + 1 < executor->n_timed && _fsm_executor_before(executor->timed[child + 1], executor->timed[child])){
+            child++;
+        }
+        if (!_fsm_executor_before(executor->timed[child], pointer)){
+            break;
+        }
+        _fsm_executor_heap_set(executor, index, executor->timed[child]);
+        index = child;
+    }
+    _fsm_executor_heap_set(executor, index, pointer);
+}
+
+/*! Move a pointer of the deadline heap to its place, once its deadline changed
+ */
+static void _fsm_executor_heap_fix(struct fsm_executor *executor, unsigned int index) {
+    if (index > 0 && _fsm_executor_before(executor->timed[index], executor->timed[(index - 1) / 2])){
+        _fsm_executor_heap_up(executor, index);
+    }else{
+        _fsm_executor_heap_down(executor, index);
+    }
+}
+
+/*! Remove a pointer from the pointers waiting for a timeout, the executor mutex must be held
+ *
+ *  Nothing is done if the pointer isn't waiting anymore, a worker firing the timers may have removed it.
+ */
+static void _fsm_executor_untime(struct fsm_executor *executor, struct fsm_pointer *pointer) {
+    unsigned int index = pointer->exec_timed_index;
+    if (index == FSM_EXEC_NOT_TIMED){
+        return;
+    }
+    pointer->exec_timed_index = FSM_EXEC_NOT_TIMED;
+    unsigned int n_timed = __atomic_sub_fetch(&executor->n_timed, 1, __ATOMIC_RELAXED);
+    if (index == n_timed){
+        return;
+    }
+    _fsm_executor_heap_set(executor, index, executor->timed[n_timed]);
+    _fsm_executor_heap_fix(executor, index);
+}
+
+/*! Mark a pointer as having events to handle, the executor mutex must be held if \a locked is true
+ */
+static void _fsm_executor_notify(struct fsm_executor *executor, struct fsm_pointer *pointer, bool locked) {
+    unsigned int state = __atomic_load_n(&pointer->exec_state, __ATOMIC_ACQUIRE);
+    while (1){
+        if (state == FSM_EXEC_IDLE){
+            if (__atomic_compare_exchange_n(&pointer->exec_state, &state, FSM_EXEC_QUEUED, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)){
+                // Back on the worker which last ran it
+                _fsm_executor_push(&executor->workers[__atomic_load_n(&pointer->exec_worker, __ATOMIC_RELAXED)],
+                                   pointer);
+                _fsm_executor_wake(executor, locked);
+                return;
+            }
+        }else if (state == FSM_EXEC_RUNNING){
+            // The worker running it will queue it again instead of letting it idle
+            if (__atomic_compare_exchange_n(&pointer->exec_state, &state, FSM_EXEC_NOTIFIED, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)){
+                return;
+            }
+        }else{
+            // Queued or already notified : the events will be seen, stopped : they will be released by the join
+            return;
+        }
+    }
+}
+
+void _fsm_executor_schedule(struct fsm_pointer *pointer) {
+    // Order the push of the events before the read of the state, see _fsm_executor_run
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    _fsm_executor_notify(pointer->config.executor, pointer, false);
+}
+
+void _fsm_executor_start(struct fsm_pointer *pointer) {
+    struct fsm_executor *executor = pointer->config.executor;
+    // Spread the new pointers on the workers
+    unsigned int index = __atomic_fetch_add(&executor->next_worker, 1, __ATOMIC_RELAXED) % executor->n_workers;
+    __atomic_store_n(&pointer->exec_worker, index, __ATOMIC_RELAXED);
+    __atomic_store_n(&pointer->exec_state, FSM_EXEC_QUEUED, __ATOMIC_SEQ_CST);
+    _fsm_executor_push(&executor->workers[index], pointer);
+    _fsm_executor_wake(executor, false);
+}
+
+/*! Check if the executor stopped a pointer
+ */
+static bool _fsm_executor_is_done(struct fsm_pointer *pointer, struct fsm_step_waiter *waiter) {
+    return __atomic_load_n(&pointer->exec_state, __ATOMIC_ACQUIRE) == FSM_EXEC_DONE;
+}
+
+void _fsm_executor_join(struct fsm_pointer *pointer) {
+    struct fsm_step_waiter waiter = { .step = NULL, .leave = 0 };
+    _fsm_pointer_wait(pointer, &waiter, _fsm_executor_is_done, NULL);
+}
+
+/*! Register the timeout a pointer waits for, the executor mutex must be held
+ */
+static void _fsm_executor_time(struct fsm_executor *executor, struct fsm_pointer *pointer,
+                               const struct timespec *deadline) {
+    pointer->exec_deadline = *deadline;
+    if (pointer->exec_timed_index == FSM_EXEC_NOT_TIMED){
+        if (executor->n_timed == executor->timed_capacity){
+            unsigned int capacity = executor->timed_capacity > 0 ? 2 * executor->timed_capacity : _FSM_EXECUTOR_INIT_TIMED;
+            struct fsm_pointer **timed = realloc(executor->timed, capacity * sizeof(struct fsm_pointer *));
+            check_mem(timed);
+            executor->timed = timed;
+            executor->timed_capacity = capacity;
+        }
+        executor->timed[executor->n_timed] = pointer;
+        _fsm_executor_heap_up(executor, __atomic_fetch_add(&executor->n_timed, 1, __ATOMIC_RELAXED));
+    }else{
+        _fsm_executor_heap_fix(executor, pointer->exec_timed_index);
+    }
+    if (executor->timed[0] == pointer){
+        // Idle workers could be waiting for a later timeout
+        _fsm_executor_wake(executor, true);
+    }
+    return;
+    error:
+    exit(1);
+}
+
+/*! Register or remove the timeout of a pointer which have nothing left to do
+ *
+ *  The worker running the pointer remembers the timeout it registered, so the executor mutex is only taken when the
+ *  timeout changes and not every time the pointer idles. A timeout fired meanwhile notified the pointer, which is run
+ *  again and raises it.
+ */
+static void _fsm_executor_idle_timeout(struct fsm_executor *executor, struct fsm_pointer *pointer,
+                                       const struct timespec *deadline) {
+    if (deadline != NULL){
+        if (pointer->exec_run_timed && pointer->exec_run_deadline.tv_sec == deadline->tv_sec &&
+                pointer->exec_run_deadline.tv_nsec == deadline->tv_nsec){
+            return;
+        }
+        pthread_mutex_lock(&executor->mutex);
+        _fsm_executor_time(executor, pointer, deadline);
+        pthread_mutex_unlock(&executor->mutex);
+        pointer->exec_run_deadline = *deadline;
+        pointer->exec_run_timed = true;
+    }else if (pointer->exec_run_timed){
+        pthread_mutex_lock(&executor->mutex);
+        _fsm_executor_untime(executor, pointer);
+        pthread_mutex_unlock(&executor->mutex);
+        pointer->exec_run_timed = false;
+    }
+}
+
+/*! Run a ready pointer then queue it again, let it idle or release it according to what is left to do
+ */
+static void _fsm_executor_run(struct fsm_executor_worker *worker, struct fsm_pointer *pointer) {
+    struct fsm_executor *executor = worker->executor;
+    const struct timespec *deadline;
+    __atomic_store_n(&pointer->exec_worker, worker->index, __ATOMIC_RELAXED);
+    __atomic_store_n(&pointer->exec_state, FSM_EXEC_RUNNING, __ATOMIC_SEQ_CST);
+    // Order the state change before the read of the input, see _fsm_executor_schedule
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int rc = _fsm_pointer_run(pointer, FSM_EXECUTOR_BUDGET, &deadline, NULL);
+    if (rc == FSM_POINTER_RUN_DONE){
+        _fsm_executor_idle_timeout(executor, pointer, NULL);
+        // The joining thread frees the pointer once it saw the state, so wake it up before releasing the mutex
+        pthread_mutex_lock(&pointer->mutex);
+        __atomic_store_n(&pointer->exec_state, FSM_EXEC_DONE, __ATOMIC_SEQ_CST);
+        _fsm_wake_step_waiters(pointer);
+        pthread_mutex_unlock(&pointer->mutex);
+        return;
+    }
+    if (rc == FSM_POINTER_RUN_IDLE){
+        // The timer is set before idling, so a timeout due right after can't be missed
+        _fsm_executor_idle_timeout(executor, pointer, deadline);
+        unsigned int state = FSM_EXEC_RUNNING;
+        if (__atomic_compare_exchange_n(&pointer->exec_state, &state, FSM_EXEC_IDLE, false,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE)){
+            return;
+        }
+    }
+    // Events left or notified while running : back at the end of the run queue so other pointers get their turn
+    __atomic_store_n(&pointer->exec_state, FSM_EXEC_QUEUED, __ATOMIC_SEQ_CST);
+    _fsm_executor_push(worker, pointer);
+    // Let an idle worker steal it if this one is busy with an other pointer
+    _fsm_executor_wake(executor, false);
+}
+
+/*! Queue the pointers which timeout is due, the executor mutex must be held
+ */
+static void _fsm_executor_fire_timers(struct fsm_executor *executor) {
+    while (executor->n_timed > 0 && !fsm_time_check_absolute_time(executor->timed[0]->exec_deadline)){
+        struct fsm_pointer *pointer = executor->timed[0];
+        _fsm_executor_untime(executor, pointer);
+        _fsm_executor_notify(executor, pointer, true);
+    }
+}
+
+/*! Main loop of a worker thread, run the ready pointers and fire the timeouts
+ */
+static void *_fsm_executor_worker(void *_worker) {
+    struct fsm_executor_worker *worker = _worker;
+    struct fsm_executor *executor = worker->executor;
+    while (1){
+        // Busy workers still fire the timeouts, but never wait for the executor mutex to do it
+        if (__atomic_load_n(&executor->n_timed, __ATOMIC_RELAXED) > 0 &&
+                pthread_mutex_trylock(&executor->mutex) == 0){
+            _fsm_executor_fire_timers(executor);
+            pthread_mutex_unlock(&executor->mutex);
+        }
+        struct fsm_pointer *pointer = _fsm_executor_take(worker);
+        if (pointer != NULL){
+            _fsm_executor_run(worker, pointer);
+            continue;
+        }
+        pthread_mutex_lock(&executor->mutex);
+        _fsm_executor_fire_timers(executor);
+        // Producers check idle_workers after queueing : either they see us or we see their pointer
+        __atomic_add_fetch(&executor->idle_workers, 1, __ATOMIC_SEQ_CST);
+        bool stop = false;
+        if (!_fsm_executor_has_ready(executor)){
+            if (executor->stopping){
+                stop = true;
+            }else if (executor->n_timed > 0){
+                struct timespec deadline = executor->timed[0]->exec_deadline;
+                pthread_cond_timedwait(&executor->cond, &executor->mutex, &deadline);
+            }else{
+                pthread_cond_wait(&executor->cond, &executor->mutex);
+            }
+        }
+        __atomic_sub_fetch(&executor->idle_workers, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&executor->mutex);
+        if (stop){
+            break;
+        }
+    }
+    return NULL;
+}
+
+struct fsm_executor *fsm_executor_create(unsigned int n_workers) {
+    pthread_condattr_t attr;
+    struct fsm_executor *executor = malloc(sizeof(struct fsm_executor));
+    check_mem(executor);
+    check(n_workers > 0, "A fsm_executor must have at least one worker");
+    executor->workers = malloc(n_workers * sizeof(struct fsm_executor_worker));
+    check_mem(executor->workers);
+    executor->n_workers = n_workers;
+    executor->next_worker = 0;
+    executor->idle_workers = 0;
+    executor->timed = NULL;
+    executor->n_timed = 0;
+    executor->timed_capacity = 0;
+    executor->stopping = false;
+    check(pthread_mutex_init(&executor->mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
+    pthread_condattr_init(&attr);
+    check(pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE) == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK");
+    check(pthread_cond_init(&executor->cond, &attr) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_destroy(&attr);
+    for (unsigned int i = 0; i < n_workers; i++){
+        struct fsm_executor_worker *worker = &executor->workers[i];
+        check(pthread_mutex_init(&worker->mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
+        worker->first = NULL;
+        worker->last = NULL;
+        worker->count = 0;
+        worker->index = i;
+        worker->executor = executor;
+    }
+    for (unsigned int i = 0; i < n_workers; i++){
+        check(pthread_create(&executor->workers[i].thread, NULL, &_fsm_executor_worker, &executor->workers[i]) == 0,
+              "ERROR DURING WORKER CREATION");
+    }
+    return executor;
+    error:
+    exit(1);
+}
+
+void fsm_executor_delete(struct fsm_executor *executor) {
+    pthread_mutex_lock(&executor->mutex);
+    executor->stopping = true;
+    pthread_cond_broadcast(&executor->cond);
+    pthread_mutex_unlock(&executor->mutex);
+    for (unsigned int i = 0; i < executor->n_workers; i++){
+        pthread_join(executor->workers[i].thread, NULL);
+        pthread_mutex_destroy(&executor->workers[i].mutex);
+    }
+    pthread_mutex_destroy(&executor->mutex);
+    pthread_cond_destroy(&executor->cond);
+    free(executor->timed);
+    free(executor->workers);
+    free(executor);
+}
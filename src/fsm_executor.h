@@ -0,0 +1,137 @@
+/*!
+ * \file fsm_executor.h
+ * \brief Fixed pool of worker threads running many fsm_pointer
+ *
+ * A pointer configured with an executor (see fsm_config_pointer) has no thread of its own : it's a task which is
+ * queued on the executor when it has pending events or when the timeout of its current step is due. A worker runs
+ * it until it has nothing left to do (or has used its budget) then takes the next ready pointer. A pointer is never
+ * run by two workers at the same time, and events are handled in the order they have been signaled.
+ *
+ * Every worker has its own run queue. A pointer is queued back on the worker which last ran it, so it keeps its
+ * memory in that worker cache, and a worker with an empty run queue steals half of the run queue of an other one,
+ * so a burst on some pointers is spread on all the workers.
+ *
+ * Pointers are joined with fsm_join_pointer(fsm_pointer*) as usual, they must all be joined before the executor is
+ * deleted.
+ *
+ * @warning A callback run by a worker blocks the whole worker : waiting into a callback for an other pointer of the
+ * same executor can dead lock if all the workers do the same.
+ */
+
+#ifndef FSM_EXECUTOR_H
+#define FSM_EXECUTOR_H
+
+#include <time.h>
+#include <stdbool.h>
+#include "pthread.h"
+
+// Scheduling state of a pointer run by an executor
+#define FSM_EXEC_IDLE       0   // Waiting for an event or a timeout
+#define FSM_EXEC_QUEUED     1   // Into the run queue of a worker
+#define FSM_EXEC_RUNNING    2   // Run by a worker
+#define FSM_EXEC_NOTIFIED   3   // Run by a worker, and new events arrived meanwhile
+#define FSM_EXEC_DONE       4   // Stopped, ready to be joined
+
+// Return values of _fsm_pointer_run
+#define FSM_POINTER_RUN_IDLE    0   // No event left
+#define FSM_POINTER_RUN_AGAIN   1   // The budget have been used, there could be events left
+#define FSM_POINTER_RUN_DONE    2   // The pointer stopped
+
+#define FSM_EXECUTOR_BUDGET 64      // Maximum number of events handled by a worker before running an other pointer
+#define FSM_EXEC_NOT_TIMED ((unsigned int) -1)  // exec_timed_index of a pointer which isn't waiting for a timeout
+
+struct fsm_pointer;
+struct fsm_step_waiter;
+
+struct fsm_executor_worker {
+    pthread_mutex_t mutex;
+    struct fsm_pointer * first;     // Run queue linked by exec_next
+    struct fsm_pointer * last;
+    unsigned int count;             // Number of pointers into the run queue, read without the mutex
+    unsigned int index;
+    struct fsm_executor * executor;
+    pthread_t thread;
+};
+
+struct fsm_executor {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            // Use the monotonic clock, signaled when a pointer is ready
+    unsigned int idle_workers;      // Number of workers waiting on the condition, read without the mutex
+    struct fsm_pointer ** timed;    // Min-heap on the exec_deadline of the pointers waiting for a timeout
+    unsigned int n_timed;           // Number of timed pointers, read without the mutex
+    unsigned int timed_capacity;
+    unsigned int n_workers;
+    unsigned int next_worker;       // Worker on which the next started pointer is queued
+    struct fsm_executor_worker * workers;
+    bool stopping;
+};
+
+typedef struct fsm_executor fsm_executor;
+
+/*! Create a fsm_executor and start its workers
+ *      @param n_workers Number of worker threads, must be greater than 0
+ *
+ *  @return Pointer to the new fsm_executor
+ *
+ *  @see fsm_executor_delete(fsm_executor*)
+ */
+struct fsm_executor *fsm_executor_create(unsigned int n_workers);
+
+/*! Stop the workers of a fsm_executor and free it
+ *      @param executor Pointer to the fsm_executor
+ *
+ *  @warning All the pointers run by the executor must have been joined before
+ */
+void fsm_executor_delete(struct fsm_executor *executor);
+
+/*! Schedule a pointer on its executor because new events are into its input
+ *      @param pointer Pointer to the fsm_pointer
+ *
+ *  @note Nothing but an atomic operation is done if the pointer is already queued or run
+ */
+void _fsm_executor_schedule(struct fsm_pointer *pointer);
+
+/*! Queue a starting pointer on its executor, the mutex of the pointer must be held
+ *      @param pointer Pointer to the fsm_pointer
+ */
+void _fsm_executor_start(struct fsm_pointer *pointer);
+
+/*! Wait until a closing pointer have been stopped by its executor
+ *      @param pointer Pointer to the fsm_pointer
+ */
+void _fsm_executor_join(struct fsm_pointer *pointer);
+
+/*! Run a pointer without ever blocking, only called by the workers of an executor or for a synchronous pointer
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param budget Maximum number of events to handle
+ *      @param deadline Set to the timeout of the current step when FSM_POINTER_RUN_IDLE is returned, \a NULL if none
+ *      @param handled Set to the number of events handled, can be \a NULL
+ *
+ *  @retval FSM_POINTER_RUN_IDLE if there is no event left
+ *  @retval FSM_POINTER_RUN_AGAIN if the budget have been used
+ *  @retval FSM_POINTER_RUN_DONE if the pointer stopped
+ */
+int _fsm_pointer_run(struct fsm_pointer *pointer, unsigned int budget, const struct timespec **deadline,
+                     unsigned int *handled);
+
+/*! Register a waiter on a pointer and block until its condition is true
+ *      @param pointer Pointer to the fsm_pointer
+ *      @param waiter Pointer to the fsm_step_waiter, with its \a step and \a leave fields set
+ *      @param is_done Condition of the waiter, called with the pointer mutex held
+ *      @param abstime Absolute monotonic time to wait until, \a NULL to wait forever
+ *
+ *  @retval 0 if the condition is true
+ *  @retval ETIMEDOUT otherwise
+ *
+ *  The waiter is only woken up by the changes of the pointer which can make it done : reaching or leaving its step,
+ *  or any change if it has no step.
+ */
+int _fsm_pointer_wait(struct fsm_pointer *pointer, struct fsm_step_waiter *waiter,
+                      bool (*is_done)(struct fsm_pointer *, struct fsm_step_waiter *), const struct timespec *abstime);
+
+/*! Wake up the waiters a change of a pointer can make done, the pointer mutex must be held
+ *      @param pointer Pointer to the fsm_pointer
+ */
+void _fsm_wake_step_waiters(struct fsm_pointer *pointer);
+
+#endif //FSM_EXECUTOR_H
@@ -0,0 +1,100 @@
+//
+// Pollable file descriptor for synchronous pointers
+//
+
+#include <errno.h>
+#include <stdint.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#endif
+
+#include "fsm_debug.h"
+#include "fsm_time.h"
+#include "fsm_fd.h"
+
+int fsm_fd_open(struct fsm_fd *fd) {
+    fd->poll_fd = -1;
+    fd->event_fd = -1;
+    fd->timer_fd = -1;
+    fd->signaled = 0;
+#ifdef __linux__
+    struct epoll_event ev = { .events = EPOLLIN };
+    fd->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    check(fd->event_fd != -1, "Impossible to create the eventfd");
+    fd->timer_fd = timerfd_create(FSM_CLOCK_MONOTONIC_SOURCE, TFD_NONBLOCK | TFD_CLOEXEC);
+    check(fd->timer_fd != -1, "Impossible to create the timerfd");
+    fd->poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    check(fd->poll_fd != -1, "Impossible to create the epoll file descriptor");
+    check(epoll_ctl(fd->poll_fd, EPOLL_CTL_ADD, fd->event_fd, &ev) == 0, "Impossible to poll the eventfd");
+    check(epoll_ctl(fd->poll_fd, EPOLL_CTL_ADD, fd->timer_fd, &ev) == 0, "Impossible to poll the timerfd");
+    return 0;
+    error:
+    fsm_fd_close(fd);
+    return -1;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+void fsm_fd_close(struct fsm_fd *fd) {
+#ifdef __linux__
+    if (fd->poll_fd != -1){
+        close(fd->poll_fd);
+    }
+    if (fd->event_fd != -1){
+        close(fd->event_fd);
+    }
+    if (fd->timer_fd != -1){
+        close(fd->timer_fd);
+    }
+#endif
+    fd->poll_fd = -1;
+    fd->event_fd = -1;
+    fd->timer_fd = -1;
+}
+
+void fsm_fd_signal(struct fsm_fd *fd) {
+#ifdef __linux__
+    if (__atomic_exchange_n(&fd->signaled, 1, __ATOMIC_SEQ_CST) == 0){
+        uint64_t one = 1;
+        if (write(fd->event_fd, &one, sizeof(one)) != sizeof(one)){
+            log_warn("Impossible to write the eventfd");
+        }
+    }
+#endif
+}
+
+void fsm_fd_clear(struct fsm_fd *fd) {
+#ifdef __linux__
+    uint64_t value;
+    while (read(fd->event_fd, &value, sizeof(value)) == -1 && errno == EINTR);
+    while (read(fd->timer_fd, &value, sizeof(value)) == -1 && errno == EINTR);
+    // Cleared once drained : a write racing with the read leaves the eventfd readable at worst, it's never lost.
+    // Signals coming after this point write the eventfd again : either they see it cleared or we see their events
+    __atomic_store_n(&fd->signaled, 0, __ATOMIC_SEQ_CST);
+#endif
+}
+
+void fsm_fd_set_timer(struct fsm_fd *fd, const struct timespec *abstime) {
+#ifdef __linux__
+    struct itimerspec timer = {
+            .it_interval = { .tv_sec = 0, .tv_nsec = 0 },
+            .it_value = { .tv_sec = 0, .tv_nsec = 0 },
+    };
+    if (abstime != NULL){
+        timer.it_value = *abstime;
+        if (timer.it_value.tv_sec == 0 && timer.it_value.tv_nsec == 0){
+            // A zero value would disarm the timer
+            timer.it_value.tv_nsec = 1;
+        }
+    }
+    if (timerfd_settime(fd->timer_fd, TFD_TIMER_ABSTIME, &timer, NULL) == -1){
+        log_warn("Impossible to arm the timerfd");
+    }
+#endif
+}
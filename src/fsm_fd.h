@@ -0,0 +1,56 @@
+/*!
+ * \file fsm_fd.h
+ * \brief Pollable file descriptor telling an event loop that a synchronous pointer has work to do
+ *
+ * The file descriptor is an epoll one gathering an eventfd, written when events are signaled, and a timerfd, armed
+ * on the timeout of the current step. It can be added to any poll, select or epoll set of the application, and
+ * becomes readable when one of them is.
+ *
+ * Only available on Linux, fsm_fd_open(fsm_fd*) fails elsewhere.
+ */
+
+#ifndef FSM_FD_H
+#define FSM_FD_H
+
+#include <time.h>
+#include <stdbool.h>
+
+struct fsm_fd {
+    int poll_fd;            // Epoll file descriptor given to the application
+    int event_fd;
+    int timer_fd;           // Use the monotonic clock
+    unsigned int signaled;  // The eventfd have been written since the last clear, avoid a syscall per event
+};
+
+/*! Create the file descriptors of a fsm_fd
+ *      @param fd Pointer to the fsm_fd
+ *
+ *  @retval 0 on success
+ *  @retval -1 if a file descriptor can't be created, errno is set
+ */
+int fsm_fd_open(struct fsm_fd *fd);
+
+/*! Close the file descriptors of a fsm_fd
+ *      @param fd Pointer to the fsm_fd
+ */
+void fsm_fd_close(struct fsm_fd *fd);
+
+/*! Make the fsm_fd readable, because events have been signaled
+ *      @param fd Pointer to the fsm_fd
+ *
+ *  @note Only the first call after fsm_fd_clear(fsm_fd*) costs a syscall
+ */
+void fsm_fd_signal(struct fsm_fd *fd);
+
+/*! Make the fsm_fd not readable anymore, must be called before handling the signaled events
+ *      @param fd Pointer to the fsm_fd
+ */
+void fsm_fd_clear(struct fsm_fd *fd);
+
+/*! Arm the timer of a fsm_fd, which makes it readable once reached
+ *      @param fd Pointer to the fsm_fd
+ *      @param abstime Absolute monotonic time, \a NULL to disarm the timer
+ */
+void fsm_fd_set_timer(struct fsm_fd *fd, const struct timespec *abstime);
+
+#endif //FSM_FD_H
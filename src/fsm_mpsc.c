@@ -0,0 +1,61 @@
+//
+// Lock free MPSC queue
+//
+
+#include <stddef.h>
+
+#include "fsm_mpsc.h"
+
+void fsm_mpsc_init(struct fsm_mpsc_queue *queue) {
+    queue->stub.next = NULL;
+    queue->head = &queue->stub;
+    queue->tail = &queue->stub;
+}
+
+void fsm_mpsc_push_chain(struct fsm_mpsc_queue *queue, struct fsm_mpsc_node *first, struct fsm_mpsc_node *last) {
+    __atomic_store_n(&last->next, NULL, __ATOMIC_RELAXED);
+    // Take the head place, then link the previous head to us
+    struct fsm_mpsc_node *prev = __atomic_exchange_n(&queue->head, last, __ATOMIC_SEQ_CST);
+    // Between the exchange and this store the queue is inconsistent : the consumer can't reach the chain yet
+    __atomic_store_n(&prev->next, first, __ATOMIC_RELEASE);
+}
+
+void fsm_mpsc_push(struct fsm_mpsc_queue *queue, struct fsm_mpsc_node *node) {
+    fsm_mpsc_push_chain(queue, node, node);
+}
+
+struct fsm_mpsc_node *fsm_mpsc_pop(struct fsm_mpsc_queue *queue) {
+    struct fsm_mpsc_node *tail = queue->tail;
+    struct fsm_mpsc_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (tail == &queue->stub){
+        // Skip the stub
+        if (next == NULL){
+            return NULL;
+        }
+        queue->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+    if (next != NULL){
+        queue->tail = next;
+        return tail;
+    }
+    if (tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)){
+        // A producer is pushing after the tail
+        return NULL;
+    }
+    // The tail is the last node, push back the stub behind it so it can be popped
+    fsm_mpsc_push(queue, &queue->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL){
+        queue->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+bool fsm_mpsc_is_empty(struct fsm_mpsc_queue *queue) {
+    return queue->tail == &queue->stub
+           && __atomic_load_n(&queue->stub.next, __ATOMIC_ACQUIRE) == NULL
+           && __atomic_load_n(&queue->head, __ATOMIC_SEQ_CST) == &queue->stub;
+}
@@ -0,0 +1,64 @@
+/*!
+ * \file fsm_mpsc.h
+ * \brief Lock free intrusive multi producers / single consumer queue
+ *
+ * Based on the intrusive MPSC node-based queue of Dmitry Vyukov. Any number of threads can push at the same
+ * time, a single thread can pop. Nodes are embedded into the stored objects so nothing is allocated.
+ */
+
+#ifndef FSM_MPSC_H
+#define FSM_MPSC_H
+
+#include <stdbool.h>
+
+struct fsm_mpsc_node {
+    struct fsm_mpsc_node * next;
+};
+
+struct fsm_mpsc_queue {
+    struct fsm_mpsc_node * head;    // Last pushed node, exchanged by producers
+    struct fsm_mpsc_node * tail;    // Next node to pop, only used by the consumer
+    struct fsm_mpsc_node stub;
+};
+
+/*! Init an empty fsm_mpsc_queue
+ *      @param queue Pointer to the fsm_mpsc_queue
+ *
+ *  @warning A fsm_mpsc_queue can't be copied or moved once initialised : it refers to its own stub
+ */
+void fsm_mpsc_init(struct fsm_mpsc_queue *queue);
+
+/*! Push a node at the end of the queue, can be called from any thread
+ *      @param queue Pointer to the fsm_mpsc_queue
+ *      @param node Pointer to the fsm_mpsc_node embedded into the object to store
+ */
+void fsm_mpsc_push(struct fsm_mpsc_queue *queue, struct fsm_mpsc_node *node);
+
+/*! Push a chain of nodes already linked together at the end of the queue, can be called from any thread
+ *      @param queue Pointer to the fsm_mpsc_queue
+ *      @param first Pointer to the first fsm_mpsc_node of the chain
+ *      @param last Pointer to the last fsm_mpsc_node of the chain
+ *
+ *  The whole chain is pushed with a single atomic exchange.
+ */
+void fsm_mpsc_push_chain(struct fsm_mpsc_queue *queue, struct fsm_mpsc_node *first, struct fsm_mpsc_node *last);
+
+/*! Pop the oldest node of the queue, must only be called by the consumer thread
+ *      @param queue Pointer to the fsm_mpsc_queue
+ *
+ *  @retval NULL if the queue is empty or if a producer is in the middle of a push
+ *  @retval Pointer to the oldest fsm_mpsc_node otherwise
+ *
+ *  @note As NULL can be returned while a push isn't finished, use fsm_mpsc_is_empty(fsm_mpsc_queue*) before deciding to sleep
+ */
+struct fsm_mpsc_node *fsm_mpsc_pop(struct fsm_mpsc_queue *queue);
+
+/*! Check if the queue is indeed empty, must only be called by the consumer thread
+ *      @param queue Pointer to the fsm_mpsc_queue
+ *
+ *  @retval true if nothing have been pushed since the last node popped
+ *  @retval false if a node is stored or being pushed
+ */
+bool fsm_mpsc_is_empty(struct fsm_mpsc_queue *queue);
+
+#endif //FSM_MPSC_H
@@ -0,0 +1,151 @@
+//
+// Waiter aware notification
+//
+
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <sched.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+#include "fsm_debug.h"
+#include "fsm_time.h"
+#include "fsm_notify.h"
+
+#define _FSM_NOTIFY_SPIN_MIN 16     // The adaptive spin budget never goes under this value (or spin_max)
+
+// Hint to the CPU that we are busy-polling
+#if defined(__x86_64__) || defined(__i386__)
+#define _fsm_cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define _fsm_cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define _fsm_cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+void fsm_notify_init(struct fsm_notify *notify) {
+    notify->seq = 0;
+    notify->waiters = 0;
+    notify->sleepers = 0;
+#ifndef __linux__
+    pthread_condattr_t attr;
+    check(pthread_mutex_init(&notify->mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
+    pthread_condattr_init(&attr);
+    check(pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE) == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK");
+    check(pthread_cond_init(&notify->cond, &attr) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_destroy(&attr);
+    return;
+    error:
+    exit(1);
+#endif
+}
+
+void fsm_notify_destroy(struct fsm_notify *notify) {
+#ifndef __linux__
+    pthread_mutex_destroy(&notify->mutex);
+    pthread_cond_destroy(&notify->cond);
+#endif
+}
+
+unsigned int fsm_notify_prepare(struct fsm_notify *notify) {
+    // Waker threads check waiters after making their condition true : either they see us or we see their condition
+    __atomic_add_fetch(&notify->waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&notify->seq, __ATOMIC_ACQUIRE);
+}
+
+void fsm_notify_cancel(struct fsm_notify *notify) {
+    __atomic_sub_fetch(&notify->waiters, 1, __ATOMIC_RELEASE);
+}
+
+/*! Busy-poll then yield until the seq of a fsm_notify change, adapting the spin budget
+ *
+ *  @retval true if the seq changed
+ *  @retval false if the thread has to park
+ */
+static bool _fsm_notify_spin(struct fsm_notify *notify, unsigned int key, struct fsm_notify_spin *spin) {
+    unsigned int min = spin->spin_max < _FSM_NOTIFY_SPIN_MIN ? spin->spin_max : _FSM_NOTIFY_SPIN_MIN;
+    for (unsigned int i = 0; i < spin->spin; i++){
+        if (__atomic_load_n(&notify->seq, __ATOMIC_ACQUIRE) != key){
+            // Caught while spinning, allow a longer spin next time
+            spin->spin = spin->spin > spin->spin_max / 2 ? spin->spin_max : spin->spin * 2;
+            return true;
+        }
+        _fsm_cpu_relax();
+    }
+    // Spinning have been useless, shorten it next time
+    spin->spin = spin->spin / 2 > min ? spin->spin / 2 : min;
+    for (unsigned int i = 0; i < spin->yield; i++){
+        sched_yield();
+        if (__atomic_load_n(&notify->seq, __ATOMIC_ACQUIRE) != key){
+            return true;
+        }
+    }
+    return false;
+}
+
+int fsm_notify_wait(struct fsm_notify *notify, unsigned int key, const struct timespec *abstime) {
+    return fsm_notify_wait_spin(notify, key, abstime, NULL);
+}
+
+int fsm_notify_wait_spin(struct fsm_notify *notify, unsigned int key, const struct timespec *abstime,
+                         struct fsm_notify_spin *spin) {
+    int rc = 0;
+    if (spin != NULL && _fsm_notify_spin(notify, key, spin)){
+        __atomic_sub_fetch(&notify->waiters, 1, __ATOMIC_RELEASE);
+        return 0;
+    }
+    // Waker threads check sleepers after changing seq : either they see us or we see the new seq
+    __atomic_add_fetch(&notify->sleepers, 1, __ATOMIC_SEQ_CST);
+#ifdef __linux__
+    while (__atomic_load_n(&notify->seq, __ATOMIC_ACQUIRE) == key){
+        // FUTEX_WAIT_BITSET takes an absolute monotonic timeout, it returns at once if seq isn't key anymore
+        if (syscall(SYS_futex, &notify->seq, FUTEX_WAIT_BITSET_PRIVATE, key, abstime, NULL,
+                    FUTEX_BITSET_MATCH_ANY) == -1 && errno == ETIMEDOUT){
+            rc = ETIMEDOUT;
+            break;
+        }
+    }
+#else
+    pthread_mutex_lock(&notify->mutex);
+    while (__atomic_load_n(&notify->seq, __ATOMIC_SEQ_CST) == key){
+        if (abstime == NULL){
+            pthread_cond_wait(&notify->cond, &notify->mutex);
+        }else if (pthread_cond_timedwait(&notify->cond, &notify->mutex, abstime) == ETIMEDOUT){
+            rc = ETIMEDOUT;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&notify->mutex);
+#endif
+    __atomic_sub_fetch(&notify->sleepers, 1, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&notify->waiters, 1, __ATOMIC_RELEASE);
+    return rc;
+}
+
+void fsm_notify_wake(struct fsm_notify *notify) {
+    // Order the write of the condition before the read of waiters, see fsm_notify_prepare
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&notify->waiters, __ATOMIC_RELAXED) == 0){
+        return;
+    }
+    // Spinning waiters only need the seq change
+    __atomic_add_fetch(&notify->seq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&notify->sleepers, __ATOMIC_SEQ_CST) == 0){
+        return;
+    }
+#ifdef __linux__
+    syscall(SYS_futex, &notify->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+    pthread_mutex_lock(&notify->mutex);
+    pthread_cond_broadcast(&notify->cond);
+    pthread_mutex_unlock(&notify->mutex);
+#endif
+}
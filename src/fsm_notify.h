@@ -0,0 +1,98 @@
+/*!
+ * \file fsm_notify.h
+ * \brief Waiter aware notification, a wake up costs a syscall only if a thread is parked
+ *
+ * A thread which wants to wait for a condition takes a key with fsm_notify_prepare(fsm_notify*), checks the
+ * condition, then either cancels with fsm_notify_cancel(fsm_notify*) or waits with the key. A thread which makes the
+ * condition true calls fsm_notify_wake(fsm_notify*) after. No wake up can be lost between the check and the wait,
+ * and no mutex is needed around the condition for that.
+ *
+ * A waiter can also spin then yield before parking (see fsm_notify_wait_spin), so a wake up coming soon is caught
+ * without any syscall on both sides.
+ *
+ * Built on futexes on Linux, on a mutex and a condition elsewhere.
+ */
+
+#ifndef FSM_NOTIFY_H
+#define FSM_NOTIFY_H
+
+#include <time.h>
+#include "pthread.h"
+
+struct fsm_notify {
+    unsigned int seq;       // Changed by every wake up which finds waiters, futex word on Linux
+    unsigned int waiters;   // Number of threads between fsm_notify_prepare and the end of their wait
+    unsigned int sleepers;  // Number of waiters parked into the kernel (or the condition)
+#ifndef __linux__
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;    // Use the monotonic clock
+#endif
+};
+
+struct fsm_notify_spin {
+    unsigned int spin_max;  // Maximum number of pause iterations before yielding, 0 to never spin
+    unsigned int yield;     // Number of sched_yield before parking
+    unsigned int spin;      // Pause iterations done by the next wait, adapted after each wait
+};
+
+/*! Init a fsm_notify
+ *      @param notify Pointer to the fsm_notify
+ */
+void fsm_notify_init(struct fsm_notify *notify);
+
+/*! Destroy a fsm_notify, no thread must be waiting on it
+ *      @param notify Pointer to the fsm_notify
+ */
+void fsm_notify_destroy(struct fsm_notify *notify);
+
+/*! Register the calling thread as a waiter, it must check its condition after this call
+ *      @param notify Pointer to the fsm_notify
+ *
+ *  @return Key to give to fsm_notify_wait(fsm_notify*, unsigned int, const struct timespec*)
+ *
+ *  @warning Must be followed by fsm_notify_wait(fsm_notify*, unsigned int, const struct timespec*) or fsm_notify_cancel(fsm_notify*)
+ */
+unsigned int fsm_notify_prepare(struct fsm_notify *notify);
+
+/*! Unregister the calling thread, its condition became true after fsm_notify_prepare(fsm_notify*)
+ *      @param notify Pointer to the fsm_notify
+ */
+void fsm_notify_cancel(struct fsm_notify *notify);
+
+/*! Park the calling thread until a wake up happens after the given key have been taken
+ *      @param notify Pointer to the fsm_notify
+ *      @param key Key returned by fsm_notify_prepare(fsm_notify*)
+ *      @param abstime Absolute monotonic time to wait until, \a NULL to wait forever
+ *
+ *  @retval 0 if the thread have been woken up (or the wake up happened before the wait)
+ *  @retval ETIMEDOUT if the timeout is reached
+ *
+ *  @note The thread is unregistered when the function returns, the condition must be checked again
+ */
+int fsm_notify_wait(struct fsm_notify *notify, unsigned int key, const struct timespec *abstime);
+
+/*! Same as fsm_notify_wait(fsm_notify*, unsigned int, const struct timespec*) but busy-poll then yield before parking
+ *      @param notify Pointer to the fsm_notify
+ *      @param key Key returned by fsm_notify_prepare(fsm_notify*)
+ *      @param abstime Absolute monotonic time to wait until, \a NULL to wait forever
+ *      @param spin Spin policy of the waiter, \a NULL to park at once
+ *
+ *  @retval 0 if the thread have been woken up
+ *  @retval ETIMEDOUT if the timeout is reached
+ *
+ *  The spin budget is adaptive : it doubles (up to \a spin_max) each time a wake up is caught while spinning and is
+ *  halved each time the thread had to yield or park, so a waiter which is rarely woken up quickly stops burning CPU.
+ *
+ *  @note The timeout is only checked once parked
+ */
+int fsm_notify_wait_spin(struct fsm_notify *notify, unsigned int key, const struct timespec *abstime,
+                         struct fsm_notify_spin *spin);
+
+/*! Wake up all the threads waiting on the fsm_notify, must be called after the condition became true
+ *      @param notify Pointer to the fsm_notify
+ *
+ *  @note Nothing but an atomic load is done if there is no waiter, and no syscall if no waiter is parked
+ */
+void fsm_notify_wake(struct fsm_notify *notify);
+
+#endif //FSM_NOTIFY_H
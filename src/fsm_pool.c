@@ -0,0 +1,164 @@
+//
+// Event pool
+//
+
+/*
+ * fsm_event are allocated by slabs and recycled instead of being freed.
+ *
+ * Each thread keep its own cache of free events so acquiring and releasing an event usually take no lock.
+ * As events are often acquired by a thread (producer) and released by an other one (the pointer thread),
+ * caches exchange events by batches through a global depot when they are too full or empty.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "fsm.h"
+#include "fsm_debug.h"
+
+#define _FSM_POOL_BATCH_LEN 64                          // Events allocated or exchanged with the depot at once
+#define _FSM_POOL_CACHE_MAX_LEN (4 * _FSM_POOL_BATCH_LEN) // Events kept by a thread before giving back a batch
+
+struct _fsm_event_slab {
+    struct _fsm_event_slab *next;
+    struct fsm_event events[_FSM_POOL_BATCH_LEN];
+};
+
+// Slabs are never freed, they are kept here so the memory is still reachable
+static struct _fsm_event_slab *_slabs = NULL;
+// Free events shared between threads
+static struct fsm_event *_depot = NULL;
+static pthread_mutex_t _depot_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread struct fsm_event *_cache = NULL;
+static __thread unsigned int _cache_len = 0;
+// Key used to give the cache back to the depot when a thread exits
+static pthread_key_t _cache_key;
+static pthread_once_t _cache_key_once = PTHREAD_ONCE_INIT;
+
+/*! Detach at most n events from the head of a free list
+ *      @param list Pointer to the head of the list, updated to the first event kept
+ *      @param n Maximum number of events to detach
+ *      @param last Set to the last event detached
+ *
+ *  @return Number of events detached
+ */
+static unsigned int _fsm_pool_detach(struct fsm_event **list, unsigned int n, struct fsm_event **last){
+    unsigned int count = 0;
+    struct fsm_event *cursor = *list;
+    *last = NULL;
+    while (cursor != NULL && count < n){
+        *last = cursor;
+        cursor = cursor->next;
+        count++;
+    }
+    *list = cursor;
+    return count;
+}
+
+/*! Give at most n events of the thread cache to the depot
+ */
+static void _fsm_pool_flush(unsigned int n){
+    struct fsm_event *first = _cache;
+    struct fsm_event *last;
+    unsigned int count = _fsm_pool_detach(&_cache, n, &last);
+    if (count == 0){
+        return;
+    }
+    _cache_len -= count;
+    pthread_mutex_lock(&_depot_mutex);
+    last->next = _depot;
+    _depot = first;
+    pthread_mutex_unlock(&_depot_mutex);
+}
+
+static void _fsm_pool_thread_exit(void *unused){
+    _fsm_pool_flush(_cache_len);
+}
+
+static void _fsm_pool_init_key(){
+    pthread_key_create(&_cache_key, _fsm_pool_thread_exit);
+}
+
+/*! Make sure the cache of the calling thread will be given back to the depot at thread exit
+ */
+static void _fsm_pool_register_thread(){
+    pthread_once(&_cache_key_once, _fsm_pool_init_key);
+    // Any non NULL value so the destructor is called
+    pthread_setspecific(_cache_key, (void *) &_cache_key);
+}
+
+/*! Refill the empty thread cache from the depot, or from a new slab if the depot is empty too
+ */
+static void _fsm_pool_refill(){
+    struct fsm_event *last;
+    _fsm_pool_register_thread();
+    pthread_mutex_lock(&_depot_mutex);
+    if (_depot != NULL){
+        _cache = _depot;
+        _cache_len = _fsm_pool_detach(&_depot, _FSM_POOL_BATCH_LEN, &last);
+        last->next = NULL;
+        pthread_mutex_unlock(&_depot_mutex);
+        return;
+    }
+    // Every event starts on its own cache line
+    struct _fsm_event_slab *slab = aligned_alloc(_Alignof(struct _fsm_event_slab), sizeof(struct _fsm_event_slab));
+    check_mem(slab);
+    slab->next = _slabs;
+    _slabs = slab;
+    pthread_mutex_unlock(&_depot_mutex);
+    for (unsigned int i = 0; i < _FSM_POOL_BATCH_LEN; i++){
+        slab->events[i].next = (i + 1 < _FSM_POOL_BATCH_LEN) ? &slab->events[i + 1] : NULL;
+    }
+    _cache = &slab->events[0];
+    _cache_len = _FSM_POOL_BATCH_LEN;
+    return;
+    error:
+    log_err("Impossible to allocate a new slab of events");
+    exit(1);
+}
+
+struct fsm_event *fsm_event_acquire() {
+    if (_cache == NULL){
+        _fsm_pool_refill();
+    }
+    struct fsm_event *event = _cache;
+    _cache = event->next;
+    _cache_len--;
+    memset(event, 0, sizeof(struct fsm_event));
+    return event;
+}
+
+/*! Put an event into the thread cache
+ */
+static void _fsm_pool_put(struct fsm_event *event){
+    if (_cache == NULL){
+        _fsm_pool_register_thread();
+    }
+    event->next = _cache;
+    _cache = event;
+    _cache_len++;
+    if (_cache_len > _FSM_POOL_CACHE_MAX_LEN){
+        _fsm_pool_flush(_FSM_POOL_BATCH_LEN);
+    }
+}
+
+void fsm_event_release(struct fsm_event *event) {
+    if (event == NULL || event->preallocated){
+        return;
+    }
+    struct fsm_event *shared = event->shared;
+    if (shared != NULL){
+        // A delivery only borrows the args of the published event, which goes with the last delivery
+        _fsm_pool_put(event);
+        if (__atomic_sub_fetch(&shared->refs, 1, __ATOMIC_ACQ_REL) != 0){
+            return;
+        }
+        event = shared;
+    }
+    if (event->args_free != NULL){
+        event->args_free(event->args);
+    }
+    _fsm_pool_put(event);
+}
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <stdio.h>
 #include "fsm_debug.h"
+#include "fsm_time.h"
 #include "fsm_queue.h"
 
 
@@ -15,29 +16,73 @@ struct fsm_queue create_fsm_queue() {
             .last = NULL,
             .mutex = NULL,
             .cond = NULL,
+            .silent = 0,
+            .intrusive = 0,
+            .link_offset = 0,
     };
+    pthread_condattr_t attr;
     check(pthread_mutex_init(&queue.mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
-    check(pthread_cond_init(&queue.cond, NULL) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_init(&attr);
+    check(pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE) == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK");
+    check(pthread_cond_init(&queue.cond, &attr) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_destroy(&attr);
     return queue;
     error:
     exit(1);
 }
 
-void *fsm_queue_push_back_more(
-        struct fsm_queue *queue, void *_value, const unsigned short size, unsigned short copy) {
-    // Alocate memory for the new fsm_queue_elem
-    struct fsm_queue_elem * elem = malloc(sizeof(struct fsm_queue_elem));
+struct fsm_queue create_fsm_queue_intrusive(size_t link_offset) {
+    struct fsm_queue queue = create_fsm_queue();
+    queue.intrusive = 1;
+    queue.link_offset = link_offset;
+    return queue;
+}
+
+/*! Get the fsm_queue_elem to link a value into the queue
+ *      @param queue Pointer to the fsm_queue
+ *      @param _value Generic void pointer to the element to store
+ *      @param size Size in bytes of the pointed variable
+ *      @param copy Set to 1 to copy the element into the heap
+ *
+ *  @return The fsm_queue_elem, allocated or embedded into the value for an intrusive queue
+ */
+static struct fsm_queue_elem *_fsm_queue_new_elem(struct fsm_queue *queue, void *_value,
+                                                  const unsigned short size, unsigned short copy) {
+    void *value = _value;
+    struct fsm_queue_elem *elem;
     if (copy) {
         // Allocate memory into the heap for the given pointer
-        elem->value = malloc(size);
+        value = malloc(size);
+        check_mem(value);
         // Copy memory
-        memcpy(elem->value, _value, size);
+        memcpy(value, _value, size);
+    }
+    if (queue->intrusive) {
+        // The link is a part of the value, nothing more to allocate
+        elem = (struct fsm_queue_elem *) ((char *) value + queue->link_offset);
     }else{
-        // Just store the pointer
-        elem->value = _value;
+        // Alocate memory for the new fsm_queue_elem
+        elem = malloc(sizeof(struct fsm_queue_elem));
+        check_mem(elem);
     }
+    elem->value = value;
+    return elem;
+    error:
+    exit(1);
+}
+
+/*! Free a fsm_queue_elem removed from the queue, do nothing for an intrusive queue
+ */
+static void _fsm_queue_free_elem(struct fsm_queue *queue, struct fsm_queue_elem *elem) {
+    if (!queue->intrusive) {
+        free(elem);
+    }
+}
+
+/*! Link a fsm_queue_elem at the end of the queue, the queue mutex must be held
+ */
+static void _fsm_queue_link_back(struct fsm_queue *queue, struct fsm_queue_elem *elem) {
     elem->next = NULL; // It's the last elem
-    pthread_mutex_lock(&queue->mutex);
     elem->prev = queue->last; // Before it, is the old last elem
     if (elem->prev != NULL) {
         // If there was someone before, make it know that it isn't the last anymore
@@ -47,9 +92,57 @@ void *fsm_queue_push_back_more(
         queue->first = elem;
     }
     queue->last = elem; // Tell the queue that we are the new last elem
-    pthread_cond_broadcast(&queue->cond); // Signal a change into the queue
+    if (!queue->silent){
+        pthread_cond_broadcast(&queue->cond); // Signal a change into the queue
+    }
+}
+
+void *fsm_queue_push_back_more(
+        struct fsm_queue *queue, void *_value, const unsigned short size, unsigned short copy) {
+    struct fsm_queue_elem * elem = _fsm_queue_new_elem(queue, _value, size, copy);
+    pthread_mutex_lock(&queue->mutex);
+    // Keep the value, the elem can be popped and freed as soon as the mutex is released
+    void *value = elem->value;
+    _fsm_queue_link_back(queue, elem);
+    pthread_mutex_unlock(&queue->mutex);
+    return value;
+}
+
+void fsm_queue_push_back_locked(struct fsm_queue *queue, void *value) {
+    _fsm_queue_link_back(queue, _fsm_queue_new_elem(queue, value, 0, 0));
+}
+
+void fsm_queue_push_back_batch(struct fsm_queue *queue, void **values, unsigned int n) {
+    struct fsm_queue_elem *first = NULL;
+    struct fsm_queue_elem *last = NULL;
+    if (n == 0){
+        return;
+    }
+    // Link the new fsm_queue_elem together out of the lock
+    for (unsigned int i = 0; i < n; i++){
+        struct fsm_queue_elem *elem = _fsm_queue_new_elem(queue, values[i], 0, 0);
+        elem->next = NULL;
+        elem->prev = last;
+        if (last != NULL){
+            last->next = elem;
+        }else{
+            first = elem;
+        }
+        last = elem;
+    }
+    pthread_mutex_lock(&queue->mutex);
+    // Append the whole chain after the old last elem
+    first->prev = queue->last;
+    if (queue->last != NULL){
+        queue->last->next = first;
+    }else{
+        queue->first = first;
+    }
+    queue->last = last;
+    if (!queue->silent){
+        pthread_cond_broadcast(&queue->cond); // Signal a change into the queue, once for the whole batch
+    }
     pthread_mutex_unlock(&queue->mutex);
-    return elem->value;
 }
 
 void *fsm_queue_push_back(struct fsm_queue *queue, void *_value, const unsigned short size) {
@@ -69,7 +162,7 @@ void *fsm_queue_pop_front(struct fsm_queue *queue) {
     // Tell the queue that the new first element have change
     queue->first = queue->first->next;
     // Free the fsm_queue_elem which stored the value
-    free(fsm_elem_to_free);
+    _fsm_queue_free_elem(queue, fsm_elem_to_free);
     if(queue->first != NULL) {
         // Tell the new first element that there isn't something behind it anymore
         queue->first->prev = NULL;
@@ -81,15 +174,26 @@ void *fsm_queue_pop_front(struct fsm_queue *queue) {
     return value;
 }
 
+struct fsm_queue_elem *fsm_queue_take_all(struct fsm_queue *queue) {
+    struct fsm_queue_elem *first = queue->first;
+    queue->first = NULL;
+    queue->last = NULL;
+    return first;
+}
+
 void fsm_queue_cleanup(struct fsm_queue *queue) {
+    fsm_queue_cleanup_more(queue, free);
+}
+
+void fsm_queue_cleanup_more(struct fsm_queue *queue, void (*free_fnct)(void *)) {
     while(queue->first != NULL){
-        free(fsm_queue_pop_front(queue));
+        free_fnct(fsm_queue_pop_front(queue));
     }
 }
 
-struct fsm_queue *create_fsm_queue_pointer() {
-    // Create a fsm_queue
-    struct fsm_queue _q = create_fsm_queue();
+/*! Copy a fsm_queue into the heap and return a pointer to it
+ */
+static struct fsm_queue *_fsm_queue_to_heap(struct fsm_queue _q) {
     // Allocate memory into the heap
     struct fsm_queue * queue = malloc(sizeof(struct fsm_queue));
     // Copy stack fsm_queue to heap memory
@@ -98,6 +202,14 @@ struct fsm_queue *create_fsm_queue_pointer() {
     return queue;
 }
 
+struct fsm_queue *create_fsm_queue_pointer() {
+    return _fsm_queue_to_heap(create_fsm_queue());
+}
+
+struct fsm_queue *create_fsm_queue_intrusive_pointer(size_t link_offset) {
+    return _fsm_queue_to_heap(create_fsm_queue_intrusive(link_offset));
+}
+
 void fsm_queue_delete_queue_pointer(struct fsm_queue *queue) {
     fsm_queue_cleanup(queue);
     free(queue);
@@ -121,7 +233,7 @@ void *fsm_queue_get_elem(struct fsm_queue *queue, void *elem) {
             }else{
                 cursor->prev->next = cursor->next;
             }
-            free(cursor);   // Freeing the fsm_queue_elem to avoid memory leaks
+            _fsm_queue_free_elem(queue, cursor);   // Freeing the fsm_queue_elem to avoid memory leaks
             pthread_mutex_unlock(&queue->mutex);
             return elem;
         }
@@ -132,17 +244,7 @@ void *fsm_queue_get_elem(struct fsm_queue *queue, void *elem) {
 }
 
 void *fsm_queue_push_top_more(struct fsm_queue *queue, void *_value, const unsigned short size, unsigned short copy) {
-    // Alocate memory for the new fsm_queue_elem
-    struct fsm_queue_elem * elem = malloc(sizeof(struct fsm_queue_elem));
-    if (copy) {
-        // Allocate memory into the heap for the given pointer
-        elem->value = malloc(size);
-        // Copy memory
-        memcpy(elem->value, _value, size);
-    }else{
-        // Just store the pointer
-        elem->value = _value;
-    }
+    struct fsm_queue_elem * elem = _fsm_queue_new_elem(queue, _value, size, copy);
     elem->prev = NULL; // It's the fisrt elem
     pthread_mutex_lock(&queue->mutex);
     elem->next = queue->first; // Before it, is the old first elem
@@ -154,9 +256,13 @@ void *fsm_queue_push_top_more(struct fsm_queue *queue, void *_value, const unsig
         queue->last = elem;
     }
     queue->first = elem; // Tell the queue that we are the new last elem
-    pthread_cond_broadcast(&queue->cond); // Signal a change into the queue
+    // Keep the value, the elem can be popped and freed as soon as the mutex is released
+    void *value = elem->value;
+    if (!queue->silent){
+        pthread_cond_broadcast(&queue->cond); // Signal a change into the queue
+    }
     pthread_mutex_unlock(&queue->mutex);
-    return elem->value;
+    return value;
 }
 
 void *fsm_queue_push_top(struct fsm_queue *queue, void *_value, const unsigned short size) {
@@ -12,6 +12,8 @@
 #ifndef FSM_QUEUE_H
 #define FSM_QUEUE_H
 
+#include <stddef.h>
+#include <time.h>
 #include "pthread.h"
 
 struct fsm_queue_elem {
@@ -24,13 +26,35 @@ struct fsm_queue {
     struct fsm_queue_elem * first;
     struct fsm_queue_elem * last;
     pthread_mutex_t mutex;
-    pthread_cond_t cond;
+    pthread_cond_t cond;        // Use the monotonic clock, broadcast on every push unless the queue is silent
+    unsigned short silent;      // Set to 1 if nobody waits on cond, the consumer being woken up by other means
+    unsigned short intrusive;   // Set to 1 if the fsm_queue_elem are embedded into the stored values
+    size_t link_offset;         // Offset of the embedded fsm_queue_elem into the stored values
 };
 
 /*! Create a fsm_queue and return it
  */
 struct fsm_queue create_fsm_queue ();
 
+/*! Create an intrusive fsm_queue and return it
+ *      @param link_offset Offset (as return by \a offsetof) of the fsm_queue_elem embedded into the stored values
+ *
+ *  The fsm_queue_elem of an intrusive queue live into the stored values, so pushing and popping allocate nothing
+ *  (except the copy of the value if asked). Every other function work the same way on it.
+ *
+ *  Example :
+ *  @code{.c}
+ *  struct my_value {
+ *      int data;
+ *      struct fsm_queue_elem link;
+ *  };
+ *  struct fsm_queue queue = create_fsm_queue_intrusive(offsetof(struct my_value, link));
+ *  @endcode
+ *
+ *  @warning A value can only be stored into one intrusive queue using the same link at a time
+ */
+struct fsm_queue create_fsm_queue_intrusive(size_t link_offset);
+
 /* Create a fsm_queue in heap memory and return a pointer to it
  *
  * @return pointer to fsm_queue
@@ -39,6 +63,15 @@ struct fsm_queue create_fsm_queue ();
  * */
 struct fsm_queue * create_fsm_queue_pointer();
 
+/*! Create an intrusive fsm_queue in heap memory and return a pointer to it
+ *      @param link_offset Offset of the fsm_queue_elem embedded into the stored values
+ *
+ *  @return pointer to fsm_queue
+ *
+ *  @see create_fsm_queue_intrusive(size_t)
+ */
+struct fsm_queue * create_fsm_queue_intrusive_pointer(size_t link_offset);
+
 /*! Copy an element into the heap and store it at the end of the queue
  *      @param queue Pointer to the fsm_queue
  *      @param _value Generic void pointer to the element to store
@@ -78,6 +111,29 @@ void *fsm_queue_push_back(struct fsm_queue *queue, void *_value, const unsigned
 void *fsm_queue_push_back_more(struct fsm_queue *queue, void *_value,
                                const unsigned short size, unsigned short copy);
 
+/*! Push several elements at the end of the queue at once
+ *      @param queue Pointer to the fsm_queue
+ *      @param values Array of generic void pointers to store, they are not copied
+ *      @param n Number of values into the array
+ *
+ *  The mutex is taken and the condition broadcast only once for the whole batch, values keep their order.
+ *
+ *  @see fsm_queue_push_back_more(struct fsm_queue *, void *, const unsigned short, unsigned short)
+ *  */
+void fsm_queue_push_back_batch(struct fsm_queue *queue, void **values, unsigned int n);
+
+/*! Push an element at the end of the queue while the queue mutex is already held
+ *      @param queue Pointer to the fsm_queue
+ *      @param value Generic void pointer to store, it isn't copied
+ *
+ *  Lets the caller update its own state with the same lock as the push.
+ *
+ *  @warning The queue mutex must be held by the caller
+ *
+ *  @see fsm_queue_take_all(struct fsm_queue *)
+ *  */
+void fsm_queue_push_back_locked(struct fsm_queue *queue, void *value);
+
 void *fsm_queue_push_top_more(struct fsm_queue *queue, void *_value,
                                const unsigned short size, unsigned short copy);
 
@@ -92,6 +148,19 @@ void *fsm_queue_push_top(struct fsm_queue *queue, void *_value, const unsigned s
  * */
 void *fsm_queue_pop_front(struct fsm_queue *queue);
 
+/*! Detach all the elements of the queue at once, leaving it empty
+ *      @param queue Pointer to the fsm_queue
+ *
+ *  @retval NULL if the queue is empty
+ *  @retval The first fsm_queue_elem of the detached chain otherwise, linked by their \a next field
+ *
+ *  The caller owns the detached fsm_queue_elem and must free them, unless the queue is intrusive.
+ *
+ *  @warning The queue mutex must be held by the caller, so it can wait on the queue condition and take the elements
+ *  with a single lock.
+ * */
+struct fsm_queue_elem *fsm_queue_take_all(struct fsm_queue *queue);
+
 /*! Search an elem into the queue and get it
  *      @param queue Pointer to the fsm_queue in which search
  *      @param elem Generic void pointer to the elem
@@ -113,6 +182,14 @@ void *fsm_queue_get_elem(struct fsm_queue *queue, void *elem);
  *  */
 void fsm_queue_cleanup(struct fsm_queue *queue);
 
+/*! Pop all elements into the queue and give them to a custom free function
+ *      @param queue Pointer to the fsm_queue
+ *      @param free_fnct Function called on every value popped
+ *
+ *  @see fsm_queue_cleanup(fsm_queue *)
+ *  */
+void fsm_queue_cleanup_more(struct fsm_queue *queue, void (*free_fnct)(void *));
+
 /*! Cleanup the given fsm_queue and free it after
  *      @param queue Pointer to the fsm_queue to delete
  *
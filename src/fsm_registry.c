@@ -0,0 +1,164 @@
+//
+// Event UID registry
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "fsm.h"
+#include "fsm_debug.h"
+#include "fsm_registry.h"
+
+#define _FSM_REGISTRY_INIT_CAPACITY 64 // Must be a power of 2
+#define _FSM_REGISTRY_CHUNK_SHIFT 8
+#define _FSM_REGISTRY_CHUNK_LEN (1 << _FSM_REGISTRY_CHUNK_SHIFT)
+#define _FSM_REGISTRY_MAX_CHUNKS 4096
+
+// Slots of the open addressing table store IDs, the UID of an ID is found in _uid_chunks.
+// UIDs are stored by chunks which never move so they can be read without taking the lock.
+static unsigned int *_slots = NULL;
+static unsigned int _slots_capacity = 0;
+static char **_uid_chunks[_FSM_REGISTRY_MAX_CHUNKS];
+static unsigned int _count = 0;
+static pthread_rwlock_t _lock = PTHREAD_RWLOCK_INITIALIZER;
+static pthread_once_t _once = PTHREAD_ONCE_INIT;
+
+/*! FNV-1a hash of an UID string
+ */
+static unsigned int _fsm_registry_hash(const char *uid){
+    unsigned int hash = 2166136261u;
+    while (*uid != '\0'){
+        hash ^= (unsigned char) *uid++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*! Return the interned UID of a registered ID
+ */
+static inline char *_fsm_registry_get(unsigned int id){
+    return _uid_chunks[id >> _FSM_REGISTRY_CHUNK_SHIFT][id & (_FSM_REGISTRY_CHUNK_LEN - 1)];
+}
+
+/*! Return the slot where the UID is or should be stored
+ *
+ *  @note The lock must be held by the caller
+ */
+static unsigned int _fsm_registry_slot(const char *uid){
+    unsigned int mask = _slots_capacity - 1;
+    unsigned int slot = _fsm_registry_hash(uid) & mask;
+    while (_slots[slot] != FSM_REGISTRY_NO_ID && strcmp(_fsm_registry_get(_slots[slot]), uid) != 0){
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*! Double the size of the table and re-insert every ID
+ *
+ *  @note The write lock must be held by the caller
+ */
+static void _fsm_registry_grow(){
+    unsigned int *old_slots = _slots;
+    unsigned int old_capacity = _slots_capacity;
+    _slots_capacity *= 2;
+    _slots = calloc(_slots_capacity, sizeof(unsigned int));
+    check_mem(_slots);
+    for (unsigned int i = 0; i < old_capacity; i++){
+        if (old_slots[i] != FSM_REGISTRY_NO_ID){
+            _slots[_fsm_registry_slot(_fsm_registry_get(old_slots[i]))] = old_slots[i];
+        }
+    }
+    free(old_slots);
+    return;
+    error:
+    exit(1);
+}
+
+/*! Insert a new UID and give it the next ID
+ *
+ *  @note The write lock must be held by the caller
+ */
+static unsigned int _fsm_registry_insert(const char *uid, unsigned int slot){
+    if (strlen(uid) >= MAX_EVENT_UID_LEN){
+        log_warn("Event UID \"%s\" is longer than MAX_EVENT_UID_LEN", uid);
+    }
+    unsigned int id = _count + 1;
+    check(id >> _FSM_REGISTRY_CHUNK_SHIFT < _FSM_REGISTRY_MAX_CHUNKS, "Too many event UIDs registered");
+    if (_uid_chunks[id >> _FSM_REGISTRY_CHUNK_SHIFT] == NULL){
+        _uid_chunks[id >> _FSM_REGISTRY_CHUNK_SHIFT] = calloc(_FSM_REGISTRY_CHUNK_LEN, sizeof(char *));
+        check_mem(_uid_chunks[id >> _FSM_REGISTRY_CHUNK_SHIFT]);
+    }
+    char *interned = strdup(uid);
+    check_mem(interned);
+    _uid_chunks[id >> _FSM_REGISTRY_CHUNK_SHIFT][id & (_FSM_REGISTRY_CHUNK_LEN - 1)] = interned;
+    _slots[slot] = id;
+    // Publish the new ID only once its UID is stored, so lock free readers never see a NULL UID
+    __atomic_store_n(&_count, id, __ATOMIC_RELEASE);
+    if (2 * _count > _slots_capacity){
+        // Keep the table at most half full to have short probes
+        _fsm_registry_grow();
+    }
+    return id;
+    error:
+    exit(1);
+}
+
+/*! Allocate the table and register system events in the order of their reserved IDs
+ */
+static void _fsm_registry_init(){
+    const char *system_uids[] = {
+            [_EVENT_STOP_POINTER_ID] = _EVENT_STOP_POINTER_UID,
+            [_EVENT_DIRECT_TRANSITION_ID] = _EVENT_DIRECT_TRANSITION_UID,
+            [_EVENT_START_POINTER_ID] = _EVENT_START_POINTER_UID,
+            [_EVENT_OUT_ACTION_ID] = _EVENT_OUT_ACTION_UID,
+            [_EVENT_TIMEOUT_ID] = _EVENT_TIMEOUT_UID,
+            [_EVENT_TIMER_ID] = _EVENT_TIMER_UID,
+    };
+    _slots_capacity = _FSM_REGISTRY_INIT_CAPACITY;
+    _slots = calloc(_slots_capacity, sizeof(unsigned int));
+    check_mem(_slots);
+    for (unsigned int id = 1; id < sizeof(system_uids) / sizeof(system_uids[0]); id++){
+        _fsm_registry_insert(system_uids[id], _fsm_registry_slot(system_uids[id]));
+    }
+    return;
+    error:
+    exit(1);
+}
+
+unsigned int fsm_registry_find(const char *uid) {
+    pthread_once(&_once, _fsm_registry_init);
+    pthread_rwlock_rdlock(&_lock);
+    unsigned int id = _slots[_fsm_registry_slot(uid)];
+    pthread_rwlock_unlock(&_lock);
+    return id;
+}
+
+unsigned int fsm_registry_intern(const char *uid) {
+    unsigned int id = fsm_registry_find(uid);
+    if (id != FSM_REGISTRY_NO_ID){
+        return id;
+    }
+    pthread_rwlock_wrlock(&_lock);
+    // Search again, someone could have registered it while we were waiting for the lock
+    unsigned int slot = _fsm_registry_slot(uid);
+    id = _slots[slot];
+    if (id == FSM_REGISTRY_NO_ID){
+        id = _fsm_registry_insert(uid, slot);
+    }
+    pthread_rwlock_unlock(&_lock);
+    return id;
+}
+
+const char *fsm_registry_uid(unsigned int id) {
+    if (id == FSM_REGISTRY_NO_ID || id > fsm_registry_count()){
+        return NULL;
+    }
+    // No lock needed : chunks never move and the ID is published after its UID
+    return _fsm_registry_get(id);
+}
+
+unsigned int fsm_registry_count() {
+    pthread_once(&_once, _fsm_registry_init);
+    return __atomic_load_n(&_count, __ATOMIC_ACQUIRE);
+}
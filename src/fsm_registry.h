@@ -0,0 +1,43 @@
+/*!
+ * \file fsm_registry.h
+ * \brief Thread safe registry which intern event UID strings into compact numeric IDs
+ *
+ * Each distinct event UID is given an unique ID the first time it's seen. IDs start at 1 and grow
+ * one by one so they can be used to index arrays. The ID 0 is never given and means "no event".
+ */
+
+#ifndef FSM_REGISTRY_H
+#define FSM_REGISTRY_H
+
+#define FSM_REGISTRY_NO_ID 0
+
+/*! Get the ID of an UID, register it if it's the first time it's seen
+ *      @param uid Event UID string
+ *
+ *  @return The ID interned for this UID
+ *
+ *  @note The UID is copied into the registry, you can free or modify yours after this call
+ */
+unsigned int fsm_registry_intern(const char *uid);
+
+/*! Get the ID of an UID without registering it
+ *      @param uid Event UID string
+ *
+ *  @retval FSM_REGISTRY_NO_ID if the UID have never been registered
+ *  @retval The ID interned for this UID otherwise
+ */
+unsigned int fsm_registry_find(const char *uid);
+
+/*! Get the UID string interned for the given ID
+ *      @param id ID returned by fsm_registry_intern(const char*)
+ *
+ *  @retval NULL if the ID is unknown
+ *  @retval Pointer to the interned UID string otherwise, valid as long as the process lives
+ */
+const char *fsm_registry_uid(unsigned int id);
+
+/*! Number of IDs registered so far, the bigger ID given is equal to this value
+ */
+unsigned int fsm_registry_count();
+
+#endif //FSM_REGISTRY_H
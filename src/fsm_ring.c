@@ -0,0 +1,190 @@
+//
+// Bounded ring buffer
+//
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "fsm_debug.h"
+#include "fsm_time.h"
+#include "fsm_ring.h"
+
+struct fsm_ring *fsm_ring_create(unsigned int capacity) {
+    pthread_condattr_t attr;
+    struct fsm_ring *ring = malloc(sizeof(struct fsm_ring));
+    check_mem(ring);
+    check(capacity > 0, "A fsm_ring must have a capacity greater than 0");
+    ring->slots = malloc(capacity * sizeof(void *));
+    check_mem(ring->slots);
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->count = 0;
+    ring->high_water = 0;
+    ring->dropped = 0;
+    ring->kicked = false;
+    check(pthread_mutex_init(&ring->mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
+    pthread_condattr_init(&attr);
+    check(pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE) == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK");
+    check(pthread_cond_init(&ring->not_empty, &attr) == 0, "ERROR DURING CONDITION INIT");
+    check(pthread_cond_init(&ring->not_full, NULL) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_destroy(&attr);
+    return ring;
+    error:
+    exit(1);
+}
+
+void fsm_ring_delete(struct fsm_ring *ring, void (*free_fnct)(void *)) {
+    void *value;
+    while ((value = fsm_ring_pop(ring)) != NULL){
+        if (free_fnct != NULL){
+            free_fnct(value);
+        }
+    }
+    pthread_mutex_destroy(&ring->mutex);
+    pthread_cond_destroy(&ring->not_empty);
+    pthread_cond_destroy(&ring->not_full);
+    free(ring->slots);
+    free(ring);
+}
+
+/*! Remove the oldest value, the mutex must be held and the ring not empty
+ */
+static void *_fsm_ring_take(struct fsm_ring *ring){
+    void *value = ring->slots[ring->head];
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+    return value;
+}
+
+int fsm_ring_push(struct fsm_ring *ring, void *value, unsigned short policy, void **dropped) {
+    int rc = FSM_RING_OK;
+    pthread_mutex_lock(&ring->mutex);
+    if (ring->count == ring->capacity){
+        switch (policy){
+            case FSM_RING_DROP_NEWEST:
+                ring->dropped++;
+                pthread_mutex_unlock(&ring->mutex);
+                *dropped = value;
+                return FSM_RING_DROPPED;
+            case FSM_RING_DROP_OLDEST:
+                ring->dropped++;
+                *dropped = _fsm_ring_take(ring);
+                rc = FSM_RING_DROPPED;
+                break;
+            case FSM_RING_FAIL:
+                pthread_mutex_unlock(&ring->mutex);
+                return FSM_RING_FULL;
+            default:
+                while (ring->count == ring->capacity){
+                    pthread_cond_wait(&ring->not_full, &ring->mutex);
+                }
+        }
+    }
+    ring->slots[(ring->head + ring->count) % ring->capacity] = value;
+    ring->count++;
+    if (ring->count > ring->high_water){
+        ring->high_water = ring->count;
+    }
+    if (ring->count == 1){
+        // Only a consumer waiting on an empty ring have to be woken up
+        pthread_cond_signal(&ring->not_empty);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+    return rc;
+}
+
+unsigned int fsm_ring_push_batch(struct fsm_ring *ring, void **values, unsigned int n, unsigned short policy,
+                                 void (*drop_fnct)(void *)) {
+    unsigned int i = 0;
+    pthread_mutex_lock(&ring->mutex);
+    unsigned int initial_count = ring->count;
+    while (i < n){
+        if (ring->count == ring->capacity){
+            if (policy == FSM_RING_DROP_NEWEST){
+                // The rest of the batch is dropped
+                ring->dropped += n - i;
+                if (drop_fnct != NULL){
+                    for (unsigned int j = i; j < n; j++){
+                        drop_fnct(values[j]);
+                    }
+                }
+                break;
+            }else if (policy == FSM_RING_DROP_OLDEST){
+                ring->dropped++;
+                void *oldest = _fsm_ring_take(ring);
+                if (drop_fnct != NULL){
+                    drop_fnct(oldest);
+                }
+            }else if (policy == FSM_RING_FAIL){
+                break;
+            }else{
+                if (initial_count == 0){
+                    // Let the consumer empty the ring before waiting for it
+                    pthread_cond_signal(&ring->not_empty);
+                }
+                while (ring->count == ring->capacity){
+                    pthread_cond_wait(&ring->not_full, &ring->mutex);
+                }
+                initial_count = ring->count;
+                continue;
+            }
+        }
+        ring->slots[(ring->head + ring->count) % ring->capacity] = values[i];
+        ring->count++;
+        i++;
+        if (ring->count > ring->high_water){
+            ring->high_water = ring->count;
+        }
+    }
+    if (initial_count == 0 && ring->count > 0){
+        pthread_cond_signal(&ring->not_empty);
+    }
+    pthread_mutex_unlock(&ring->mutex);
+    return policy == FSM_RING_DROP_NEWEST ? n : i;
+}
+
+/*! Remove the oldest value if any and wake up blocked producers, the mutex must be held
+ */
+static void *_fsm_ring_pop_locked(struct fsm_ring *ring){
+    if (ring->count == 0){
+        return NULL;
+    }
+    void *value = _fsm_ring_take(ring);
+    if (ring->count == ring->capacity - 1){
+        // The ring was full, producers could be blocked
+        pthread_cond_broadcast(&ring->not_full);
+    }
+    return value;
+}
+
+void *fsm_ring_pop(struct fsm_ring *ring) {
+    pthread_mutex_lock(&ring->mutex);
+    void *value = _fsm_ring_pop_locked(ring);
+    pthread_mutex_unlock(&ring->mutex);
+    return value;
+}
+
+void *fsm_ring_pop_timedwait(struct fsm_ring *ring, const struct timespec *abstime) {
+    pthread_mutex_lock(&ring->mutex);
+    while (ring->count == 0){
+        if (ring->kicked){
+            break;
+        }
+        if (abstime == NULL){
+            pthread_cond_wait(&ring->not_empty, &ring->mutex);
+        }else if (pthread_cond_timedwait(&ring->not_empty, &ring->mutex, abstime) == ETIMEDOUT){
+            break;
+        }
+    }
+    ring->kicked = false;
+    void *value = _fsm_ring_pop_locked(ring);
+    pthread_mutex_unlock(&ring->mutex);
+    return value;
+}
+
+void fsm_ring_kick(struct fsm_ring *ring) {
+    pthread_mutex_lock(&ring->mutex);
+    ring->kicked = true;
+    pthread_cond_broadcast(&ring->not_empty);
+    pthread_mutex_unlock(&ring->mutex);
+}
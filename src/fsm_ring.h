@@ -0,0 +1,103 @@
+/*!
+ * \file fsm_ring.h
+ * \brief Thread safe bounded ring buffer with overflow policies
+ *
+ * All the memory is allocated when the ring is created, pushing and popping never allocate.
+ */
+
+#ifndef FSM_RING_H
+#define FSM_RING_H
+
+#include <time.h>
+#include <stdbool.h>
+#include "pthread.h"
+
+#define FSM_RING_BLOCK          0   // Wait for a free slot
+#define FSM_RING_DROP_NEWEST    1   // Drop the value being pushed
+#define FSM_RING_DROP_OLDEST    2   // Drop the oldest value stored to make room
+#define FSM_RING_FAIL           3   // Refuse the value, the caller keeps it
+
+#define FSM_RING_OK             0
+#define FSM_RING_DROPPED        1   // A value have been dropped
+#define FSM_RING_FULL           2   // The value have been refused
+
+struct fsm_ring {
+    void ** slots;
+    unsigned int capacity;
+    unsigned int head;          // Index of the oldest value
+    unsigned int count;
+    unsigned int high_water;    // Biggest count reached
+    unsigned long dropped;      // Number of values dropped by the DROP policies
+    bool kicked;                // A waiting pop must return, see fsm_ring_kick
+    pthread_mutex_t mutex;
+    pthread_cond_t not_empty;   // Use the monotonic clock
+    pthread_cond_t not_full;
+};
+
+/*! Create a fsm_ring in heap memory and return a pointer to it
+ *      @param capacity Maximum number of values stored, must be greater than 0
+ *
+ *  @return pointer to fsm_ring
+ *
+ *  @see fsm_ring_delete(fsm_ring*, void (*)(void*))
+ */
+struct fsm_ring *fsm_ring_create(unsigned int capacity);
+
+/*! Free a fsm_ring and every value still stored into it
+ *      @param ring Pointer to the fsm_ring
+ *      @param free_fnct Function called on every value still stored, can be \a NULL
+ */
+void fsm_ring_delete(struct fsm_ring *ring, void (*free_fnct)(void *));
+
+/*! Push a value at the end of the ring
+ *      @param ring Pointer to the fsm_ring
+ *      @param value Generic void pointer to store
+ *      @param policy What to do if the ring is full, one of the FSM_RING_BLOCK, FSM_RING_DROP_NEWEST, FSM_RING_DROP_OLDEST or FSM_RING_FAIL
+ *      @param dropped Set to the dropped value when FSM_RING_DROPPED is returned, so the caller can free it
+ *
+ *  @retval FSM_RING_OK if the value is stored and nothing have been dropped
+ *  @retval FSM_RING_DROPPED if a value (the given one or the oldest one according to the policy) have been dropped
+ *  @retval FSM_RING_FULL if the value have been refused by the FSM_RING_FAIL policy
+ */
+int fsm_ring_push(struct fsm_ring *ring, void *value, unsigned short policy, void **dropped);
+
+/*! Push several values at the end of the ring under a single lock
+ *      @param ring Pointer to the fsm_ring
+ *      @param values Array of generic void pointers to store
+ *      @param n Number of values into the array
+ *      @param policy What to do if the ring is full, one of the FSM_RING_BLOCK, FSM_RING_DROP_NEWEST, FSM_RING_DROP_OLDEST or FSM_RING_FAIL
+ *      @param drop_fnct Function called on every value dropped by the DROP policies, can be \a NULL
+ *
+ *  @return Number of values taken by the ring, dropped ones included. With FSM_RING_FAIL the values after this
+ *  index have been refused and still belong to the caller.
+ *
+ *  The consumer is woken up once for the whole batch, or before each wait with the FSM_RING_BLOCK policy.
+ *
+ *  @warning \a drop_fnct is called with the ring mutex held, it must not use the ring
+ */
+unsigned int fsm_ring_push_batch(struct fsm_ring *ring, void **values, unsigned int n, unsigned short policy,
+                                 void (*drop_fnct)(void *));
+
+/*! Pop the oldest value of the ring
+ *      @param ring Pointer to the fsm_ring
+ *
+ *  @retval NULL if the ring is empty
+ *  @retval The oldest value otherwise
+ */
+void *fsm_ring_pop(struct fsm_ring *ring);
+
+/*! Pop the oldest value of the ring, wait for one if the ring is empty
+ *      @param ring Pointer to the fsm_ring
+ *      @param abstime Absolute monotonic time to wait until, \a NULL to wait forever
+ *
+ *  @retval NULL if the timeout is reached or the ring have been kicked
+ *  @retval The oldest value otherwise
+ */
+void *fsm_ring_pop_timedwait(struct fsm_ring *ring, const struct timespec *abstime);
+
+/*! Make the current or the next fsm_ring_pop_timedwait(fsm_ring*,const struct timespec*) return even if the ring is empty
+ *      @param ring Pointer to the fsm_ring
+ */
+void fsm_ring_kick(struct fsm_ring *ring);
+
+#endif //FSM_RING_H
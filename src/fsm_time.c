@@ -7,15 +7,123 @@
 #include "fsm_time.h"
 #include "fsm_debug.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#define _FSM_TIME_HAS_TSC
+#endif
+
 #ifdef DBG_TEST_EXE
 #include "../test/wrapper.h"
 #endif
 
+#define _FSM_TIME_TSC_CALIBRATION_NS 10000000   // Time measured by both clocks to get the TSC frequency
+#define _FSM_TIME_TSC_ANCHOR_NS 10000000        // A thread reads the precise clock again after this time
+#define _FSM_TIME_TSC_SLACK_NS 50000            // Error of the TSC clock against the precise one
+
+struct _fsm_clock {
+    unsigned short source;
+    int (*now)(struct timespec *ts);
+    long long slack_ns;     // A deadline closer than this is reached, the clock can lag behind the precise one
+};
+
+static int _fsm_clock_precise_now(struct timespec *ts) {
+    return clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, ts);
+}
+
+static int _fsm_clock_coarse_now(struct timespec *ts) {
+    return clock_gettime(CLOCK_MONOTONIC_COARSE, ts);
+}
+
+static long long _fsm_time_to_ns(struct timespec ts) {
+    return (long long) ts.tv_sec * FSM_TIME_NANO_SECONDE + ts.tv_nsec;
+}
+
+#ifdef _FSM_TIME_HAS_TSC
+static double _tsc_ns_per_tick = 0;
+// Each thread converts the TSC from its own anchor, so no state is shared between threads
+static __thread unsigned long long _tsc_anchor = 0;
+static __thread long long _tsc_anchor_ns = 0;
+
+static int _fsm_clock_tsc_now(struct timespec *ts) {
+    unsigned long long tsc = __rdtsc();
+    long long elapsed_ns = (long long) ((double) (tsc - _tsc_anchor) * _tsc_ns_per_tick);
+    if (_tsc_anchor == 0 || tsc < _tsc_anchor || elapsed_ns > _FSM_TIME_TSC_ANCHOR_NS){
+        // Anchor again on the precise clock, so the drift of the TSC never adds up
+        int rc = clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, ts);
+        if (rc == 0){
+            _tsc_anchor = __rdtsc();
+            _tsc_anchor_ns = _fsm_time_to_ns(*ts);
+        }
+        return rc;
+    }
+    long long ns = _tsc_anchor_ns + elapsed_ns;
+    ts->tv_sec = ns / FSM_TIME_NANO_SECONDE;
+    ts->tv_nsec = ns % FSM_TIME_NANO_SECONDE;
+    return 0;
+}
+
+/*! Measure the TSC frequency against the precise clock
+ *
+ *  @retval true if the TSC can be used as a clock
+ *  @retval false if it isn't invariant, so its frequency changes with the power state of the CPU
+ */
+static bool _fsm_clock_tsc_calibrate() {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx & (1 << 8))){
+        return false;
+    }
+    struct timespec start, end;
+    struct timespec sleep = { .tv_sec = 0, .tv_nsec = _FSM_TIME_TSC_CALIBRATION_NS };
+    if (clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &start) != 0){
+        return false;
+    }
+    unsigned long long tsc_start = __rdtsc();
+    nanosleep(&sleep, NULL);
+    if (clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &end) != 0){
+        return false;
+    }
+    unsigned long long tsc_end = __rdtsc();
+    if (tsc_end <= tsc_start){
+        return false;
+    }
+    _tsc_ns_per_tick = (double) fsm_time_delta_ns64(start, end) / (double) (tsc_end - tsc_start);
+    return true;
+}
+#endif
+
+static struct _fsm_clock _clocks[] = {
+        [FSM_CLOCK_PRECISE] = { .source = FSM_CLOCK_PRECISE, .now = _fsm_clock_precise_now, .slack_ns = 0 },
+        // The slack is the resolution of the clock, read when it's selected the first time
+        [FSM_CLOCK_COARSE] = { .source = FSM_CLOCK_COARSE, .now = _fsm_clock_coarse_now, .slack_ns = -1 },
+#ifdef _FSM_TIME_HAS_TSC
+        [FSM_CLOCK_TSC] = { .source = FSM_CLOCK_TSC, .now = _fsm_clock_tsc_now, .slack_ns = _FSM_TIME_TSC_SLACK_NS },
+#endif
+};
+// Read by every thread, a clock is fully set before it's selected
+static struct _fsm_clock *_clock = &_clocks[FSM_CLOCK_PRECISE];
+
+/*! Read the resolution of the coarse clock the first time it's selected
+ *
+ *  @retval true if the coarse clock can be used
+ *  @retval false if the system doesn't have it
+ */
+static bool _fsm_clock_coarse_resolution() {
+    struct timespec resolution;
+    if (_clocks[FSM_CLOCK_COARSE].slack_ns >= 0){
+        return true;
+    }
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &resolution) != 0){
+        return false;
+    }
+    _clocks[FSM_CLOCK_COARSE].slack_ns = _fsm_time_to_ns(resolution);
+    return true;
+}
 
 
 struct timespec fsm_time_get_abs_fixed_time_from_us(int delta_us) {
         struct timespec ts;
-        check(clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &ts)==0, "CRITICAL : Impossible to get boot time : abort");
+        check(__atomic_load_n(&_clock, __ATOMIC_ACQUIRE)->now(&ts)==0, "CRITICAL : Impossible to get boot time : abort");
 //        if(clock_gettime(CLOCK_BOOTTIME, &ts) != 0){
 //            log_warn("IMPORTANT : Impossible to get boot time : try with monotonic_raw");
 //            #ifdef DBG_TEST_EXE
@@ -24,9 +132,14 @@ struct timespec fsm_time_get_abs_fixed_time_from_us(int delta_us) {
 //            check(clock_gettime(CLOCK_MONOTONIC_RAW, &ts)==0, "CRITICAL : Impossible to get monotonic_raw time : abort");
 //        }
         ts.tv_sec += delta_us / 1000000;
-        ts.tv_nsec +=  1000 * ( delta_us % 1000 );
+        ts.tv_nsec +=  1000 * ( delta_us % 1000000 );
         ts.tv_sec += ts.tv_nsec / FSM_TIME_NANO_SECONDE;
         ts.tv_nsec %= FSM_TIME_NANO_SECONDE;
+        if (ts.tv_nsec < 0){
+            // A negative delta can make the nanoseconds negative
+            ts.tv_sec--;
+            ts.tv_nsec += FSM_TIME_NANO_SECONDE;
+        }
         return ts;
     error:
         dbg_test_exe(ts.tv_nsec = 0; ts.tv_sec = 0;)
@@ -36,30 +149,50 @@ struct timespec fsm_time_get_abs_fixed_time_from_us(int delta_us) {
 }
 
 int fsm_time_delta_ns(struct timespec t_start, struct timespec t_end) {
-    int delta_s = (int)(t_end.tv_sec - t_start.tv_sec);
-    if (delta_s > FSM_TIME_MAX_INT_NANO_SECONDE){
+    long long delta_s = (long long)(t_end.tv_sec - t_start.tv_sec);
+    if (delta_s > FSM_TIME_MAX_INT_NANO_SECONDE + 1){
         // Overflow we return maximum value
         return INT_MAX;
-    } else if (delta_s < -FSM_TIME_NANO_SECONDE){
+    } else if (delta_s < -(FSM_TIME_MAX_INT_NANO_SECONDE + 1)){
         // Overflow we return minimum value
         return -INT_MAX;
     }
-    delta_s *= FSM_TIME_NANO_SECONDE; // Now represent nanosecond
-    int delta_ns = (int)(t_end.tv_nsec - t_start.tv_nsec);
-    if(delta_ns > 0){
-        if(delta_ns > INT_MAX - delta_s){
-            // Overflow we return maximum value
-            return INT_MAX;
-        }
-    }else{
-        if(-delta_ns > INT_MAX + delta_s){
-            // Overflow we return minimum value
-            return -INT_MAX;
-        }
+    // Computed on 64 bits : seconds and nanoseconds can have opposite signs around a second boundary
+    long long delta_ns = delta_s * FSM_TIME_NANO_SECONDE + (t_end.tv_nsec - t_start.tv_nsec);
+    if (delta_ns > INT_MAX){
+        return INT_MAX;
+    } else if (delta_ns < -INT_MAX){
+        return -INT_MAX;
     }
-    return delta_ns + delta_s; // Should be protected from overflow !
+    return (int) delta_ns;
+}
+
+long long fsm_time_delta_ns64(struct timespec t_start, struct timespec t_end) {
+    return (long long)(t_end.tv_sec - t_start.tv_sec) * FSM_TIME_NANO_SECONDE + (t_end.tv_nsec - t_start.tv_nsec);
 }
 
 bool fsm_time_check_absolute_time(struct timespec ts){
-    return fsm_time_delta_ns(fsm_time_get_abs_fixed_time_from_us(0), ts) > 0;
+    long long slack_ns = __atomic_load_n(&_clock, __ATOMIC_ACQUIRE)->slack_ns;
+    return fsm_time_delta_ns64(fsm_time_get_abs_fixed_time_from_us(0), ts) > slack_ns;
+}
+
+unsigned short fsm_time_set_clock(unsigned short source) {
+    struct _fsm_clock *clock = &_clocks[FSM_CLOCK_PRECISE];
+    if (source == FSM_CLOCK_COARSE && _fsm_clock_coarse_resolution()){
+        clock = &_clocks[FSM_CLOCK_COARSE];
+    }
+#ifdef _FSM_TIME_HAS_TSC
+    if (source == FSM_CLOCK_TSC && (_tsc_ns_per_tick > 0 || _fsm_clock_tsc_calibrate())){
+        clock = &_clocks[FSM_CLOCK_TSC];
+    }
+#endif
+    if (clock->source != source){
+        log_warn("Clock %u isn't available, the precise one is used", source);
+    }
+    __atomic_store_n(&_clock, clock, __ATOMIC_RELEASE);
+    return clock->source;
+}
+
+unsigned short fsm_time_get_clock() {
+    return __atomic_load_n(&_clock, __ATOMIC_ACQUIRE)->source;
 }
\ No newline at end of file
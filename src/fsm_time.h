@@ -14,11 +14,42 @@
 #define FSM_TIME_MAX_INT_NANO_SECONDE INT_MAX / 1000000000
 #define FSM_CLOCK_MONOTONIC_SOURCE 1 // CLOCK_MONOTONIC_RAW
 
+// Clocks giving the current time to the deadlines, all on the timebase of FSM_CLOCK_MONOTONIC_SOURCE
+#define FSM_CLOCK_PRECISE   0   // clock_gettime of FSM_CLOCK_MONOTONIC_SOURCE
+#define FSM_CLOCK_COARSE    1   // CLOCK_MONOTONIC_COARSE, as cheap as a memory read but precise to a few milliseconds
+#define FSM_CLOCK_TSC       2   // Time stamp counter calibrated against the precise clock, x86 with an invariant TSC only
+
 struct timespec fsm_time_get_abs_fixed_time_from_us(int delta_us);
 
 int fsm_time_delta_ns(struct timespec t_start, struct timespec t_end);
 
+/*! Same as fsm_time_delta_ns(struct timespec, struct timespec) without saturation
+ *      @param t_start Start time
+ *      @param t_end End time
+ *
+ *  @return Nanoseconds from t_start to t_end, on 64 bits
+ */
+long long fsm_time_delta_ns64(struct timespec t_start, struct timespec t_end);
+
 bool fsm_time_check_absolute_time(struct timespec ts);
 
+/*! Select the clock used to compute and check the deadlines of all the pointers
+ *      @param source One of the FSM_CLOCK_* clocks
+ *
+ *  @return The clock actually selected, FSM_CLOCK_PRECISE if the given one isn't available
+ *
+ *  A cheaper clock lags behind the precise one the threads are woken up with, so a deadline closer than its
+ *  resolution is considered reached : timeouts can be raised up to this resolution early.
+ *
+ *  @warning Must be called before any pointer is started
+ */
+unsigned short fsm_time_set_clock(unsigned short source);
+
+/*! Get the clock used to compute and check the deadlines
+ *
+ *  @return One of the FSM_CLOCK_* clocks
+ */
+unsigned short fsm_time_get_clock();
+
 #endif //FSM_TIMING_H
 
@@ -0,0 +1,264 @@
+//
+// Hierarchical timer wheel
+//
+
+#include <stdlib.h>
+
+#include "fsm_debug.h"
+#include "fsm_time.h"
+#include "fsm_timer.h"
+
+/*! Nanoseconds elapsed from the origin of the wheel to the given time, negative if it's before
+ */
+static int64_t _fsm_timer_ns_of(struct fsm_timer_wheel *wheel, const struct timespec *ts) {
+    return fsm_time_delta_ns64(wheel->origin, *ts);
+}
+
+/*! Tick of the given time rounded up, so a timer never fires early
+ */
+static uint64_t _fsm_timer_tick_ceil(struct fsm_timer_wheel *wheel, const struct timespec *ts) {
+    int64_t ns = _fsm_timer_ns_of(wheel, ts);
+    int64_t tick_ns = (int64_t) wheel->tick_us * 1000;
+    return ns <= 0 ? 0 : (uint64_t)((ns + tick_ns - 1) / tick_ns);
+}
+
+/*! Current tick, rounded down
+ */
+static uint64_t _fsm_timer_tick_now(struct fsm_timer_wheel *wheel) {
+    struct timespec now;
+    clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &now);
+    int64_t ns = _fsm_timer_ns_of(wheel, &now);
+    return ns <= 0 ? 0 : (uint64_t) ns / ((uint64_t) wheel->tick_us * 1000);
+}
+
+/*! Absolute monotonic time of the start of a tick
+ */
+static struct timespec _fsm_timer_time_of_tick(struct fsm_timer_wheel *wheel, uint64_t tick) {
+    uint64_t ns = tick * wheel->tick_us * 1000 + (uint64_t) wheel->origin.tv_nsec;
+    struct timespec ts = {
+            .tv_sec = wheel->origin.tv_sec + (time_t)(ns / FSM_TIME_NANO_SECONDE),
+            .tv_nsec = (long)(ns % FSM_TIME_NANO_SECONDE),
+    };
+    return ts;
+}
+
+static void _fsm_timer_link(struct fsm_timer **head, struct fsm_timer *timer) {
+    timer->next = *head;
+    if (*head != NULL){
+        (*head)->pprev = &timer->next;
+    }
+    *head = timer;
+    timer->pprev = head;
+}
+
+static void _fsm_timer_unlink(struct fsm_timer *timer) {
+    *timer->pprev = timer->next;
+    if (timer->next != NULL){
+        timer->next->pprev = timer->pprev;
+    }
+    timer->pprev = NULL;
+}
+
+/*! Put a timer into the slot matching its expiration, the wheel mutex must be held
+ *      @param wheel Pointer to the fsm_timer_wheel
+ *      @param timer Pointer to the fsm_timer, which expires isn't before \a base
+ *      @param base Next tick to be processed
+ *
+ *  A timer goes on the lowest wheel which current round contains its expiration, so its slot is reached (and the timer
+ *  cascaded to the previous wheel) before it expires.
+ */
+static void _fsm_timer_place(struct fsm_timer_wheel *wheel, struct fsm_timer *timer, uint64_t base) {
+    uint64_t expires = timer->expires;
+    unsigned int level = 0;
+    while (level < FSM_TIMER_LEVELS - 1 &&
+            (expires >> (FSM_TIMER_BITS * (level + 1))) != (base >> (FSM_TIMER_BITS * (level + 1)))){
+        level++;
+    }
+    if ((expires >> (FSM_TIMER_BITS * FSM_TIMER_LEVELS)) != (base >> (FSM_TIMER_BITS * FSM_TIMER_LEVELS))){
+        // Beyond the last wheel : kept on the slot reached last, then placed again from there
+        expires = base + ((uint64_t) 1 << (FSM_TIMER_BITS * FSM_TIMER_LEVELS)) - 1;
+    }
+    _fsm_timer_link(&wheel->slots[level][(expires >> (FSM_TIMER_BITS * level)) & (FSM_TIMER_SLOTS - 1)], timer);
+}
+
+/*! Process a tick : cascade the timers of the upper wheels which slot is reached, then move the expired timers to the
+ *  expired list. The wheel mutex must be held.
+ */
+static void _fsm_timer_tick(struct fsm_timer_wheel *wheel, uint64_t tick) {
+    unsigned int level = 0;
+    while (level < FSM_TIMER_LEVELS - 1 && (tick & (((uint64_t) 1 << (FSM_TIMER_BITS * (level + 1))) - 1)) == 0){
+        level++;
+    }
+    // From the highest wheel, so cascaded timers are cascaded again if needed
+    for (; level > 0; level--){
+        struct fsm_timer **slot = &wheel->slots[level][(tick >> (FSM_TIMER_BITS * level)) & (FSM_TIMER_SLOTS - 1)];
+        struct fsm_timer *timer = *slot;
+        *slot = NULL;
+        while (timer != NULL){
+            struct fsm_timer *next = timer->next;
+            _fsm_timer_place(wheel, timer, tick);
+            timer = next;
+        }
+    }
+    struct fsm_timer **slot = &wheel->slots[0][tick & (FSM_TIMER_SLOTS - 1)];
+    while (*slot != NULL){
+        struct fsm_timer *timer = *slot;
+        _fsm_timer_unlink(timer);
+        _fsm_timer_link(&wheel->expired, timer);
+    }
+    wheel->now = tick;
+}
+
+/*! Next tick which could have expired timers : the next used slot of the first wheel, or the next cascade
+ */
+static uint64_t _fsm_timer_next_tick(struct fsm_timer_wheel *wheel) {
+    uint64_t tick = wheel->now + 1;
+    do {
+        if (wheel->slots[0][tick & (FSM_TIMER_SLOTS - 1)] != NULL){
+            return tick;
+        }
+        tick++;
+    } while ((tick & (FSM_TIMER_SLOTS - 1)) != 0);
+    return tick;
+}
+
+/*! Main loop of the wheel thread
+ */
+static void *_fsm_timer_wheel_loop(void *_wheel) {
+    struct fsm_timer_wheel *wheel = _wheel;
+    pthread_mutex_lock(&wheel->mutex);
+    while (!wheel->stopping){
+        uint64_t current = _fsm_timer_tick_now(wheel);
+        if (wheel->count == 0){
+            // Nothing to process
+            wheel->now = current > wheel->now ? current : wheel->now;
+        }
+        while (wheel->now < current){
+            _fsm_timer_tick(wheel, wheel->now + 1);
+        }
+        while (wheel->expired != NULL){
+            struct fsm_timer *timer = wheel->expired;
+            _fsm_timer_unlink(timer);
+            wheel->count--;
+            wheel->running = timer;
+            pthread_mutex_unlock(&wheel->mutex);
+            timer->fnct(timer);
+            pthread_mutex_lock(&wheel->mutex);
+            wheel->running = NULL;
+            pthread_cond_broadcast(&wheel->cancelled);
+        }
+        if (wheel->stopping){
+            break;
+        }
+        if (wheel->count == 0){
+            wheel->wake_tick = UINT64_MAX;
+            pthread_cond_wait(&wheel->cond, &wheel->mutex);
+        }else{
+            wheel->wake_tick = _fsm_timer_next_tick(wheel);
+            struct timespec wake = _fsm_timer_time_of_tick(wheel, wheel->wake_tick);
+            pthread_cond_timedwait(&wheel->cond, &wheel->mutex, &wake);
+        }
+    }
+    pthread_mutex_unlock(&wheel->mutex);
+    return NULL;
+}
+
+struct fsm_timer_wheel *fsm_timer_wheel_create(unsigned int tick_us) {
+    pthread_condattr_t attr;
+    struct fsm_timer_wheel *wheel = calloc(1, sizeof(struct fsm_timer_wheel));
+    check_mem(wheel);
+    check(tick_us > 0, "A fsm_timer_wheel must have a tick greater than 0");
+    check(clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &wheel->origin) == 0, "Impossible to get the monotonic time");
+    wheel->tick_us = tick_us;
+    wheel->now = 0;
+    wheel->wake_tick = UINT64_MAX;
+    wheel->expired = NULL;
+    wheel->running = NULL;
+    wheel->count = 0;
+    wheel->stopping = false;
+    check(pthread_mutex_init(&wheel->mutex, NULL) == 0, "ERROR DURING MUTEX INIT");
+    pthread_condattr_init(&attr);
+    check(pthread_condattr_setclock(&attr, FSM_CLOCK_MONOTONIC_SOURCE) == 0, "IMPOSSIBLE TO SET MONOTONIC CLOCK");
+    check(pthread_cond_init(&wheel->cond, &attr) == 0, "ERROR DURING CONDITION INIT");
+    check(pthread_cond_init(&wheel->cancelled, NULL) == 0, "ERROR DURING CONDITION INIT");
+    pthread_condattr_destroy(&attr);
+    check(pthread_create(&wheel->thread, NULL, &_fsm_timer_wheel_loop, wheel) == 0, "ERROR DURING THREAD CREATION");
+    return wheel;
+    error:
+    exit(1);
+}
+
+static pthread_once_t _default_once = PTHREAD_ONCE_INIT;
+static struct fsm_timer_wheel *_default_wheel = NULL;
+
+static void _fsm_timer_wheel_default_init() {
+    _default_wheel = fsm_timer_wheel_create(FSM_TIMER_DEFAULT_TICK_US);
+}
+
+struct fsm_timer_wheel *fsm_timer_wheel_default(void) {
+    pthread_once(&_default_once, _fsm_timer_wheel_default_init);
+    return _default_wheel;
+}
+
+void fsm_timer_wheel_delete(struct fsm_timer_wheel *wheel) {
+    pthread_mutex_lock(&wheel->mutex);
+    wheel->stopping = true;
+    pthread_cond_signal(&wheel->cond);
+    pthread_mutex_unlock(&wheel->mutex);
+    pthread_join(wheel->thread, NULL);
+    pthread_mutex_destroy(&wheel->mutex);
+    pthread_cond_destroy(&wheel->cond);
+    pthread_cond_destroy(&wheel->cancelled);
+    free(wheel);
+}
+
+void fsm_timer_init(struct fsm_timer *timer, void (*fnct)(struct fsm_timer *)) {
+    timer->next = NULL;
+    timer->pprev = NULL;
+    timer->expires = 0;
+    timer->fnct = fnct;
+}
+
+void fsm_timer_arm(struct fsm_timer_wheel *wheel, struct fsm_timer *timer, const struct timespec *abstime) {
+    uint64_t expires = _fsm_timer_tick_ceil(wheel, abstime);
+    pthread_mutex_lock(&wheel->mutex);
+    if (timer->pprev != NULL){
+        _fsm_timer_unlink(timer);
+    }else{
+        if (wheel->count == 0){
+            // The wheel thread doesn't follow the ticks while there is no timer
+            uint64_t current = _fsm_timer_tick_now(wheel);
+            wheel->now = current > wheel->now ? current : wheel->now;
+        }
+        wheel->count++;
+    }
+    timer->expires = expires > wheel->now ? expires : wheel->now + 1;
+    _fsm_timer_place(wheel, timer, wheel->now + 1);
+    if (timer->expires < wheel->wake_tick){
+        // The wheel thread sleeps for too long
+        pthread_cond_signal(&wheel->cond);
+    }
+    pthread_mutex_unlock(&wheel->mutex);
+}
+
+void fsm_timer_cancel(struct fsm_timer_wheel *wheel, struct fsm_timer *timer) {
+    pthread_mutex_lock(&wheel->mutex);
+    if (timer->pprev != NULL){
+        _fsm_timer_unlink(timer);
+        wheel->count--;
+    }
+    pthread_mutex_unlock(&wheel->mutex);
+}
+
+void fsm_timer_cancel_sync(struct fsm_timer_wheel *wheel, struct fsm_timer *timer) {
+    pthread_mutex_lock(&wheel->mutex);
+    while (wheel->running == timer){
+        pthread_cond_wait(&wheel->cancelled, &wheel->mutex);
+    }
+    // Disarmed after the wait, as the callback could arm the timer again
+    if (timer->pprev != NULL){
+        _fsm_timer_unlink(timer);
+        wheel->count--;
+    }
+    pthread_mutex_unlock(&wheel->mutex);
+}
@@ -0,0 +1,103 @@
+/*!
+ * \file fsm_timer.h
+ * \brief Hierarchical timer wheel, one thread serving the timers of many pointers
+ *
+ * Timers are sorted into FSM_TIMER_LEVELS wheels of FSM_TIMER_SLOTS slots. The first wheel has a slot per tick, each
+ * next one a slot per FSM_TIMER_SLOTS ticks of the previous one, and its timers are cascaded into the previous wheel
+ * when their slot is reached. Arming and cancelling a timer is O(1) and never makes a syscall but a signal to the wheel
+ * thread when the timer is earlier than everything else. The wheel thread sleeps until the next slot which could hold
+ * an expired timer.
+ *
+ * Timeouts are rounded up to the next tick, so a timer never fires early.
+ */
+
+#ifndef FSM_TIMER_H
+#define FSM_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include "pthread.h"
+
+#define FSM_TIMER_BITS      6
+#define FSM_TIMER_SLOTS     (1 << FSM_TIMER_BITS)
+#define FSM_TIMER_LEVELS    4   // With 1 ms ticks the wheels cover more than 4 hours, further timers are cascaded again
+#define FSM_TIMER_DEFAULT_TICK_US   1000
+
+struct fsm_timer {
+    struct fsm_timer * next;
+    struct fsm_timer ** pprev;  // Link pointing to this timer, NULL if the timer isn't armed
+    uint64_t expires;           // Tick at which the timer fires
+    void (*fnct)(struct fsm_timer *);   // Called by the wheel thread, without any lock held
+};
+
+struct fsm_timer_wheel {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;            // Use the monotonic clock, signaled when an earlier timer is armed
+    pthread_cond_t cancelled;       // Broadcast when a timer callback returns
+    pthread_t thread;
+    struct timespec origin;         // Time of the tick 0
+    unsigned int tick_us;
+    uint64_t now;                   // Last tick processed
+    uint64_t wake_tick;             // Tick the wheel thread sleeps until
+    struct fsm_timer * slots[FSM_TIMER_LEVELS][FSM_TIMER_SLOTS];
+    struct fsm_timer * expired;     // Timers which callback have to be called
+    struct fsm_timer * running;     // Timer which callback is being called
+    unsigned int count;             // Number of armed timers
+    bool stopping;
+};
+
+typedef struct fsm_timer_wheel fsm_timer_wheel;
+
+/*! Create a fsm_timer_wheel and start its thread
+ *      @param tick_us Duration of a tick in microseconds, the precision of the timers
+ *
+ *  @return Pointer to the new fsm_timer_wheel
+ *
+ *  @see fsm_timer_wheel_delete(fsm_timer_wheel*)
+ */
+struct fsm_timer_wheel *fsm_timer_wheel_create(unsigned int tick_us);
+
+/*! Get the fsm_timer_wheel shared by the whole process, created on first use with a FSM_TIMER_DEFAULT_TICK_US tick
+ *
+ *  @return Pointer to the default fsm_timer_wheel, which must not be deleted
+ */
+struct fsm_timer_wheel *fsm_timer_wheel_default(void);
+
+/*! Stop the thread of a fsm_timer_wheel and free it, the armed timers never fire
+ *      @param wheel Pointer to the fsm_timer_wheel
+ *
+ *  @warning The pointers using the wheel must have been joined before
+ */
+void fsm_timer_wheel_delete(struct fsm_timer_wheel *wheel);
+
+/*! Init a fsm_timer, not armed
+ *      @param timer Pointer to the fsm_timer
+ *      @param fnct Function called by the wheel thread when the timer fires
+ */
+void fsm_timer_init(struct fsm_timer *timer, void (*fnct)(struct fsm_timer *));
+
+/*! Arm a fsm_timer, or move it if it's already armed
+ *      @param wheel Pointer to the fsm_timer_wheel
+ *      @param timer Pointer to the fsm_timer
+ *      @param abstime Absolute monotonic time at which the timer fires
+ */
+void fsm_timer_arm(struct fsm_timer_wheel *wheel, struct fsm_timer *timer, const struct timespec *abstime);
+
+/*! Disarm a fsm_timer if it's armed
+ *      @param wheel Pointer to the fsm_timer_wheel
+ *      @param timer Pointer to the fsm_timer
+ *
+ *  @note The callback can still be running when the function returns, see fsm_timer_cancel_sync
+ */
+void fsm_timer_cancel(struct fsm_timer_wheel *wheel, struct fsm_timer *timer);
+
+/*! Disarm a fsm_timer and wait for its callback to return if it's running
+ *      @param wheel Pointer to the fsm_timer_wheel
+ *      @param timer Pointer to the fsm_timer
+ *
+ *  @warning Must not be called from the callback of the timer
+ */
+void fsm_timer_cancel_sync(struct fsm_timer_wheel *wheel, struct fsm_timer *timer);
+
+#endif //FSM_TIMER_H
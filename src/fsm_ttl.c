@@ -0,0 +1,167 @@
+//
+// Store of the events kept by the TTL mechanism
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fsm_debug.h"
+#include "fsm.h"
+#include "fsm_ttl.h"
+
+#define _FSM_TTL_INIT_CAPACITY 16
+
+static bool _fsm_ttl_before(struct fsm_event *a, struct fsm_event *b) {
+    return a->ttl.tv_sec < b->ttl.tv_sec || (a->ttl.tv_sec == b->ttl.tv_sec && a->ttl.tv_nsec < b->ttl.tv_nsec);
+}
+
+static void _fsm_ttl_heap_set(struct fsm_ttl_store *store, unsigned int index, struct fsm_event *event) {
+    store->heap[index] = event;
+    event->ttl_index = index;
+}
+
+static void _fsm_ttl_heap_up(struct fsm_ttl_store *store, unsigned int index) {
+    struct fsm_event *event = store->heap[index];
+    while (index > 0 && _fsm_ttl_before(event, store->heap[(index - 1) / 2])){
+        _fsm_ttl_heap_set(store, index, store->heap[(index - 1) / 2]);
+        index = (index - 1) / 2;
+    }
+    _fsm_ttl_heap_set(store, index, event);
+}
+
+static void _fsm_ttl_heap_down(struct fsm_ttl_store *store, unsigned int index) {
+    struct fsm_event *event = store->heap[index];
+    while (2 * index + 1 < store->count){
+        unsigned int child = 2 * index + 1;
+        if (child + 1 < store->count && _fsm_ttl_before(store->heap[child + 1], store->heap[child])){
+            child++;
+        }
+        if (!_fsm_ttl_before(store->heap[child], event)){
+            break;
+        }
+        _fsm_ttl_heap_set(store, index, store->heap[child]);
+        index = child;
+    }
+    _fsm_ttl_heap_set(store, index, event);
+}
+
+/*! Remove an event from the heap
+ */
+static void _fsm_ttl_heap_remove(struct fsm_ttl_store *store, struct fsm_event *event) {
+    unsigned int index = event->ttl_index;
+    store->count--;
+    if (index == store->count){
+        return;
+    }
+    _fsm_ttl_heap_set(store, index, store->heap[store->count]);
+    if (index > 0 && _fsm_ttl_before(store->heap[index], store->heap[(index - 1) / 2])){
+        _fsm_ttl_heap_up(store, index);
+    }else{
+        _fsm_ttl_heap_down(store, index);
+    }
+}
+
+/*! Remove an event from its bucket
+ */
+static void _fsm_ttl_bucket_remove(struct fsm_ttl_store *store, struct fsm_event *event) {
+    struct fsm_ttl_bucket *bucket = &store->buckets[event->id];
+    if (event->ttl_prev != NULL){
+        event->ttl_prev->next = event->next;
+    }else{
+        bucket->first = event->next;
+    }
+    if (event->next != NULL){
+        event->next->ttl_prev = event->ttl_prev;
+    }else{
+        bucket->last = event->ttl_prev;
+    }
+}
+
+void fsm_ttl_store_init(struct fsm_ttl_store *store) {
+    store->buckets = NULL;
+    store->n_buckets = 0;
+    store->heap = NULL;
+    store->count = 0;
+    store->capacity = 0;
+    store->seq = 0;
+}
+
+void fsm_ttl_store_cleanup(struct fsm_ttl_store *store) {
+    for (unsigned int i = 0; i < store->count; i++){
+        fsm_event_release(store->heap[i]);
+    }
+    free(store->buckets);
+    free(store->heap);
+    fsm_ttl_store_init(store);
+}
+
+void fsm_ttl_store_push(struct fsm_ttl_store *store, struct fsm_event *event) {
+    if (event->id >= store->n_buckets){
+        unsigned int n_buckets = store->n_buckets > 0 ? store->n_buckets : _FSM_TTL_INIT_CAPACITY;
+        while (n_buckets <= event->id){
+            n_buckets *= 2;
+        }
+        struct fsm_ttl_bucket *buckets = realloc(store->buckets, n_buckets * sizeof(struct fsm_ttl_bucket));
+        check_mem(buckets);
+        memset(buckets + store->n_buckets, 0, (n_buckets - store->n_buckets) * sizeof(struct fsm_ttl_bucket));
+        store->buckets = buckets;
+        store->n_buckets = n_buckets;
+    }
+    if (store->count == store->capacity){
+        unsigned int capacity = store->capacity > 0 ? 2 * store->capacity : _FSM_TTL_INIT_CAPACITY;
+        struct fsm_event **heap = realloc(store->heap, capacity * sizeof(struct fsm_event *));
+        check_mem(heap);
+        store->heap = heap;
+        store->capacity = capacity;
+    }
+    struct fsm_ttl_bucket *bucket = &store->buckets[event->id];
+    event->ttl_seq = store->seq++;
+    event->next = NULL;
+    event->ttl_prev = bucket->last;
+    if (bucket->last != NULL){
+        bucket->last->next = event;
+    }else{
+        bucket->first = event;
+    }
+    bucket->last = event;
+    store->heap[store->count] = event;
+    _fsm_ttl_heap_up(store, store->count++);
+    return;
+    error:
+    exit(1);
+}
+
+unsigned int fsm_ttl_store_purge(struct fsm_ttl_store *store) {
+    unsigned int purged = 0;
+    while (store->count > 0 && !fsm_time_check_absolute_time(store->heap[0]->ttl)){
+        struct fsm_event *event = store->heap[0];
+        _fsm_ttl_heap_remove(store, event);
+        _fsm_ttl_bucket_remove(store, event);
+        fsm_event_release(event);
+        purged++;
+    }
+    return purged;
+}
+
+void fsm_ttl_store_take(struct fsm_ttl_store *store, unsigned int event_id, struct fsm_event **list) {
+    if (event_id >= store->n_buckets || store->buckets[event_id].first == NULL){
+        return;
+    }
+    struct fsm_event *taken = store->buckets[event_id].first;
+    store->buckets[event_id].first = NULL;
+    store->buckets[event_id].last = NULL;
+    for (struct fsm_event *event = taken; event != NULL; event = event->next){
+        _fsm_ttl_heap_remove(store, event);
+    }
+    // Both lists are sorted by arrival order
+    struct fsm_event **tail = list;
+    while (taken != NULL){
+        if (*tail == NULL || taken->ttl_seq < (*tail)->ttl_seq){
+            struct fsm_event *next = taken->next;
+            taken->next = *tail;
+            *tail = taken;
+            taken = next;
+        }
+        tail = &(*tail)->next;
+    }
+}
@@ -0,0 +1,61 @@
+/*!
+ * \file fsm_ttl.h
+ * \brief Store of the events kept by the TTL mechanism of a pointer
+ *
+ * Events are stored into a bucket per event ID, in their arrival order, so entering a step only takes the events which
+ * can trigger one of its transitions. A min-heap on the \c ttl of the events drops the expired ones without looking
+ * at the others.
+ *
+ * The store isn't thread safe, it's only used by the thread running the pointer.
+ */
+
+#ifndef FSM_TTL_H
+#define FSM_TTL_H
+
+struct fsm_event;
+
+struct fsm_ttl_bucket {
+    struct fsm_event * first;   // Oldest event
+    struct fsm_event * last;
+};
+
+struct fsm_ttl_store {
+    struct fsm_ttl_bucket * buckets;    // Indexed by event ID
+    unsigned int n_buckets;
+    struct fsm_event ** heap;   // Min-heap on the ttl of the events
+    unsigned int count;
+    unsigned int capacity;
+    unsigned long seq;          // Arrival number of the next stored event
+};
+
+/*! Init an empty fsm_ttl_store
+ *      @param store Pointer to the fsm_ttl_store
+ */
+void fsm_ttl_store_init(struct fsm_ttl_store *store);
+
+/*! Release every event still stored into a fsm_ttl_store and free its memory
+ *      @param store Pointer to the fsm_ttl_store
+ */
+void fsm_ttl_store_cleanup(struct fsm_ttl_store *store);
+
+/*! Store an event until its ttl
+ *      @param store Pointer to the fsm_ttl_store
+ *      @param event Pointer to the fsm_event, owned by the store
+ */
+void fsm_ttl_store_push(struct fsm_ttl_store *store, struct fsm_event *event);
+
+/*! Release the stored events which ttl is reached
+ *      @param store Pointer to the fsm_ttl_store
+ *
+ *  @return Number of events released
+ */
+unsigned int fsm_ttl_store_purge(struct fsm_ttl_store *store);
+
+/*! Take the stored events of an ID and merge them into a list sorted by arrival order
+ *      @param store Pointer to the fsm_ttl_store
+ *      @param event_id ID of the events to take
+ *      @param list Head of a list of events linked by their \c next field, taken from this store only
+ */
+void fsm_ttl_store_take(struct fsm_ttl_store *store, unsigned int event_id, struct fsm_event **list);
+
+#endif //FSM_TTL_H
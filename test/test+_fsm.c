@@ -130,13 +130,74 @@ void test_fsm_break_direct_loop(void **state){
     fsm_delete_all_steps();
 }
 
+#define BENCH_EXECUTOR_POINTERS 1024
+#define BENCH_EXECUTOR_EVENTS 200
+#define BENCH_EXECUTOR_WORK 2000    // Loop iterations done by each step, so the run time isn't only scheduling
+#define BENCH_EXECUTOR_MAX_WORKERS 64
+
+void *callback_busy_work(struct fsm_context *context){
+    volatile unsigned int x = 0;
+    for (int i = 0; i < BENCH_EXECUTOR_WORK; i++){
+        x += i;
+    }
+    return NULL;
+}
+
+void benchmark_fsm_executor_scaling(void **state){
+    double reference = 0;
+    log_info("Executor scaling on %ld online cores, %u pointers x %u events", sysconf(_SC_NPROCESSORS_ONLN),
+             BENCH_EXECUTOR_POINTERS, BENCH_EXECUTOR_EVENTS);
+    for (unsigned int n_workers = 1; n_workers <= BENCH_EXECUTOR_MAX_WORKERS; n_workers *= 2){
+        struct fsm_executor *executor = fsm_executor_create(n_workers);
+        struct fsm_config_pointer config = { .lockfree_input = true, .executor = executor };
+        struct fsm_pointer **fsm = malloc(BENCH_EXECUTOR_POINTERS * sizeof(struct fsm_pointer *));
+        struct fsm_step *step_0 = fsm_create_step(callback_busy_work, NULL);
+        struct fsm_step *step_1 = fsm_create_step(callback_busy_work, NULL);
+        struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+        fsm_connect_step(step_0, step_1, "NEXT");
+        fsm_connect_step(step_1, step_0, "NEXT");
+        fsm_connect_step(step_0, step_2, "DONE");
+        for (int i = 0; i < BENCH_EXECUTOR_POINTERS; i++){
+            fsm[i] = fsm_create_pointer_config(config);
+            fsm_start_pointer(fsm[i], step_0);
+        }
+
+        double start_time = bm_get_time();
+        // Bursts : all the events of a pointer are signaled at once, the pointers then spread on the workers
+        for (int i = 0; i < BENCH_EXECUTOR_POINTERS; i++){
+            for (int e = 0; e < BENCH_EXECUTOR_EVENTS; e++){
+                fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("NEXT", NULL));
+            }
+            fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("DONE", NULL));
+        }
+        for (int i = 0; i < BENCH_EXECUTOR_POINTERS; i++){
+            fsm_wait_step_blocking(fsm[i], step_2);
+        }
+        double diff_time = bm_get_time() - start_time;
+        if (n_workers == 1){
+            reference = diff_time;
+        }
+
+        log_info("Benchmark executor with %2u workers : %f s, ~%.0f events/s, speedup x%.2f", n_workers, diff_time,
+                 BENCH_EXECUTOR_POINTERS * (BENCH_EXECUTOR_EVENTS + 1) / diff_time, reference / diff_time);
+
+        for (int i = 0; i < BENCH_EXECUTOR_POINTERS; i++){
+            fsm_delete_pointer(fsm[i]);
+        }
+        free(fsm);
+        fsm_delete_all_steps();
+        fsm_executor_delete(executor);
+    }
+}
+
 int main(void)
 {
     srand ((unsigned int) time(NULL));
-    const struct CMUnitTest tests[3] = {
+    const struct CMUnitTest tests[4] = {
             cmocka_unit_test(test_fsm_break_direct_loop),
             cmocka_unit_test(benchmark_fsm_direct_transitions),
             cmocka_unit_test(benchmark_fsm_ping_pong_transitions),
+            cmocka_unit_test(benchmark_fsm_executor_scaling),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
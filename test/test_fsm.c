@@ -10,6 +10,9 @@
 #include <cmocka.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdint.h>
 #include "pthread.h"
 #include <stdio.h>
 
@@ -181,24 +184,12 @@ void test_fsm_change_step_by_callback_return(void **state){
     fsm_start_pointer(fsm, step_0);
 
     fsm_signal_pointer_of_event(fsm, fsm_generate_event("TEST", (void *) step_2));
-    pthread_mutex_lock(&fsm->mutex);
-    while(fsm->current_step == step_1 || fsm->current_step == step_0){
-        pthread_cond_wait(&fsm->cond_event, &fsm->mutex);
-    }
-    pthread_mutex_unlock(&fsm->mutex);
+    fsm_wait_step_blocking(fsm, step_2);
     assert_ptr_equal(step_2, fsm->current_step);
     fsm_signal_pointer_of_event(fsm, fsm_generate_event("RETURN", NULL));
-    pthread_mutex_lock(&fsm->mutex);
-    while(fsm->current_step != step_0){
-        pthread_cond_wait(&fsm->cond_event, &fsm->mutex);
-    }
-    pthread_mutex_unlock(&fsm->mutex);
+    fsm_wait_step_blocking(fsm, step_0);
     fsm_signal_pointer_of_event(fsm, fsm_generate_event("TEST", (void *) step_3));
-    pthread_mutex_lock(&fsm->mutex);
-    while(fsm->current_step != step_3){
-        pthread_cond_wait(&fsm->cond_event, &fsm->mutex);
-    }
-    pthread_mutex_unlock(&fsm->mutex);
+    fsm_wait_step_blocking(fsm, step_3);
     assert_ptr_equal(step_3, fsm->current_step);
     fsm_signal_pointer_of_event(fsm, fsm_generate_event("RETURN", NULL));
 
@@ -417,11 +408,1204 @@ void test_fsm_multiple_conditional_transition(void **state){
 }
 
 
+void test_fsm_event_id(void **state){
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+
+    fsm_event_id go = fsm_event_register("GO_BY_ID");
+    assert_int_equal(fsm_event_register("GO_BY_ID"), go);
+    assert_int_not_equal(fsm_event_register("NEXT_BY_ID"), go);
+    assert_int_equal(fsm_event_register(_EVENT_TIMEOUT_UID), _EVENT_TIMEOUT_ID);
+    assert_int_equal(strcmp(fsm_event_get_uid(go), "GO_BY_ID"), 0);
+
+    // String and ID APIs can be mixed
+    fsm_connect_step_id(step_0, step_1, go);
+    fsm_connect_step(step_1, step_2, "NEXT_BY_ID");
+    fsm_start_pointer(fsm, step_0);
+
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO_BY_ID", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event_id(fsm_event_register("NEXT_BY_ID"), NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_2, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+
+    fsm_join_pointer(fsm);
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+void test_fsm_compiled_graph(void **state){
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    int signal = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+    callback_pointer_step_1 = step_1;
+    callback_pointer_step_2 = step_2;
+
+    fsm_connect_step(step_0, step_3, "GO_3");
+    fsm_add_conditional_transition_to_step(step_0, "GO", callback_condtrans_step1_or_2);
+    fsm_add_conditional_transition_to_step(step_0, "GO_3", callback_condtrans_step1_or_2); // Shadowed by GO_3 transition
+    fsm_connect_step(step_1, step_0, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_connect_step(step_2, step_0, "STEP0");
+    fsm_connect_step(step_3, step_0, "STEP0");
+    fsm_graph_compile();
+    assert_ptr_not_equal(step_0->compiled, NULL);
+    assert_int_equal(step_0->compiled->n_transitions, 2);
+    assert_ptr_equal(step_1->compiled->direct_step, step_0);
+    assert_int_not_equal(step_0->id, step_1->id);
+
+    fsm_start_pointer(fsm, step_0);
+    signal = 2;
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO", (void *)&signal));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_2, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("STEP0", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_0, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO_3", (void *)&signal));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("STEP0", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_0, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    // Step 1 directly go back to step 0
+    signal = 1;
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO", (void *)&signal));
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO_3", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_join_pointer(fsm);
+
+    // Modifying a compiled step release the graph
+    fsm_connect_step(step_3, step_1, "STEP1");
+    assert_ptr_equal(step_0->compiled, NULL);
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+void test_fsm_event_pool(void **state){
+    struct fsm_event *events[200];
+    struct fsm_event *event = fsm_generate_event("POOL", NULL);
+    fsm_event_release(event);
+    // A released event is recycled by the same thread
+    assert_ptr_equal(fsm_event_acquire(), event);
+    assert_int_equal(event->id, 0);
+    assert_ptr_equal(event->args, NULL);
+    fsm_event_release(event);
+    for (int i = 0; i < 200; i++){
+        events[i] = fsm_generate_event_id(fsm_event_register("POOL"), (void *) &events[i]);
+    }
+    for (int i = 0; i < 200; i++){
+        assert_ptr_equal(events[i]->args, (void *) &events[i]);
+        assert_int_equal(strcmp(events[i]->uid, "POOL"), 0);
+        fsm_event_release(events[i]);
+    }
+}
+
+#define LOCKFREE_PRODUCERS 4
+#define LOCKFREE_EVENTS_PER_PRODUCER 2000
+
+void *_test_fsm_lockfree_producer(void *_pointer){
+    fsm_event_id next = fsm_event_register("NEXT");
+    for (int i = 0; i < LOCKFREE_EVENTS_PER_PRODUCER; i++){
+        fsm_signal_pointer_of_event((struct fsm_pointer *)_pointer, fsm_generate_event_id(next, NULL));
+    }
+    return NULL;
+}
+
+void test_fsm_lockfree_input(void **state){
+    struct fsm_config_pointer config = {
+            .lockfree_input = true,
+    };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    pthread_t producers[LOCKFREE_PRODUCERS];
+    int value = 0;
+    struct fsm_step *step_0 = fsm_create_step(callback_increment_int_from_step, (void *)&value);
+    struct fsm_step *step_1 = fsm_create_step(callback_increment_int_from_step, (void *)&value);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+
+    fsm_connect_step(step_0, step_1, "NEXT");
+    fsm_connect_step(step_1, step_0, "NEXT");
+    fsm_connect_step(step_0, step_2, "DONE");
+    fsm_connect_step(step_1, step_2, "DONE");
+    fsm_connect_step(step_2, step_3, _EVENT_TIMEOUT_UID);
+    fsm_set_timeout_to_step(step_2, 10000);
+    fsm_start_pointer(fsm, step_0);
+
+    for (int i = 0; i < LOCKFREE_PRODUCERS; i++){
+        pthread_create(&producers[i], NULL, _test_fsm_lockfree_producer, (void *) fsm);
+    }
+    for (int i = 0; i < LOCKFREE_PRODUCERS; i++){
+        pthread_join(producers[i], NULL);
+    }
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("DONE", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_3, 5000), 0);
+    assert_int_equal(value, 1 + LOCKFREE_PRODUCERS * LOCKFREE_EVENTS_PER_PRODUCER);
+
+    fsm_join_pointer(fsm);
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+pthread_mutex_t bounded_gate = PTHREAD_MUTEX_INITIALIZER;
+
+void *callback_wait_bounded_gate(struct fsm_context *context){
+    pthread_mutex_lock(&bounded_gate);
+    pthread_mutex_unlock(&bounded_gate);
+    return NULL;
+}
+
+/*! Fill a bounded pointer of capacity 4 with 6 events while it's blocked and return how many events it got */
+int _test_fsm_bounded_input_policy(unsigned short policy, int *rc, struct fsm_input_stats *stats){
+    struct fsm_config_pointer config = {
+            .input_capacity = 4,
+            .input_overflow_policy = policy,
+    };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    int value = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(callback_wait_bounded_gate, NULL);
+    struct fsm_step *step_2 = fsm_create_step(callback_increment_int_from_step, (void *)&value);
+    fsm_connect_step(step_0, step_1, "HOLD");
+    fsm_connect_step(step_1, step_2, "NEXT");
+    fsm_connect_step(step_2, step_2, "NEXT");
+    fsm_start_pointer(fsm, step_0);
+
+    pthread_mutex_lock(&bounded_gate);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("HOLD", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    for (int i = 0; i < 6; i++){
+        struct fsm_event *event = fsm_generate_event("NEXT", NULL);
+        rc[i] = fsm_signal_pointer_of_event(fsm, event);
+        if (rc[i] == FSM_ERR_INPUT_FULL){
+            fsm_event_release(event);
+        }
+    }
+    *stats = fsm_pointer_get_input_stats(fsm);
+    pthread_mutex_unlock(&bounded_gate);
+    for (int i = 0; i < 100 && value < 4; i++){
+        usleep(10000);
+    }
+    fsm_join_pointer(fsm);
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+    return value;
+}
+
+void test_fsm_bounded_input(void **state){
+    int rc[6];
+    struct fsm_input_stats stats;
+
+    assert_int_equal(_test_fsm_bounded_input_policy(FSM_RING_DROP_NEWEST, rc, &stats), 4);
+    assert_int_equal(rc[3], 0);
+    assert_int_equal(rc[4], FSM_ERR_EVENT_DROPPED);
+    assert_int_equal(rc[5], FSM_ERR_EVENT_DROPPED);
+    assert_int_equal(stats.capacity, 4);
+    assert_int_equal(stats.pending, 4);
+    assert_int_equal(stats.high_water, 4);
+    assert_int_equal(stats.dropped, 2);
+
+    assert_int_equal(_test_fsm_bounded_input_policy(FSM_RING_DROP_OLDEST, rc, &stats), 4);
+    assert_int_equal(rc[5], 0);
+    assert_int_equal(stats.dropped, 2);
+
+    assert_int_equal(_test_fsm_bounded_input_policy(FSM_RING_FAIL, rc, &stats), 4);
+    assert_int_equal(rc[3], 0);
+    assert_int_equal(rc[4], FSM_ERR_INPUT_FULL);
+    assert_int_equal(stats.dropped, 0);
+}
+
+static bool bounded_join_done = false;
+
+void *_test_fsm_bounded_join_producer(void *_pointer){
+    while (!__atomic_load_n(&bounded_join_done, __ATOMIC_ACQUIRE)){
+        struct fsm_event *event = fsm_generate_event("NEXT", NULL);
+        if (fsm_signal_pointer_of_event((struct fsm_pointer *)_pointer, event) == FSM_ERR_INPUT_FULL){
+            fsm_event_release(event);
+        }
+    }
+    return NULL;
+}
+
+void *_test_fsm_bounded_joiner(void *_pointer){
+    fsm_join_pointer((struct fsm_pointer *)_pointer);
+    return NULL;
+}
+
+void test_fsm_bounded_join(void **state){
+    unsigned short policies[3] = { FSM_RING_DROP_OLDEST, FSM_RING_BLOCK, FSM_RING_FAIL };
+    for (int p = 0; p < 3; p++){
+        struct fsm_config_pointer config = {
+                .input_capacity = 4,
+                .input_overflow_policy = policies[p],
+        };
+        struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+        pthread_t producer, joiner;
+        int value = 0;
+        struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_1 = fsm_create_step(callback_wait_bounded_gate, NULL);
+        struct fsm_step *step_2 = fsm_create_step(callback_increment_int_from_step, (void *)&value);
+        fsm_connect_step(step_0, step_1, "HOLD");
+        fsm_connect_step(step_1, step_2, "NEXT");
+        fsm_connect_step(step_2, step_2, "NEXT");
+        fsm_start_pointer(fsm, step_0);
+
+        // Joined with a full ring while a producer keeps signaling
+        pthread_mutex_lock(&bounded_gate);
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("HOLD", NULL));
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        for (int i = 0; i < 4; i++){
+            assert_int_equal(fsm_signal_pointer_of_event(fsm, fsm_generate_event("NEXT", NULL)), 0);
+        }
+        __atomic_store_n(&bounded_join_done, false, __ATOMIC_RELEASE);
+        pthread_create(&producer, NULL, _test_fsm_bounded_join_producer, (void *) fsm);
+        pthread_create(&joiner, NULL, _test_fsm_bounded_joiner, (void *) fsm);
+        usleep(20000);
+        pthread_mutex_unlock(&bounded_gate);
+        pthread_join(joiner, NULL);
+        __atomic_store_n(&bounded_join_done, true, __ATOMIC_RELEASE);
+        pthread_join(producer, NULL);
+        assert_int_equal(fsm->running, FSM_STATE_STOPPED);
+        if (policies[p] != FSM_RING_DROP_OLDEST){
+            // The join never drops the events signaled before it
+            assert_true(value >= 4);
+        }
+
+        fsm_delete_pointer(fsm);
+        fsm_delete_all_steps();
+    }
+}
+
+#define BATCH_LEN 50
+#define BATCH_COUNT 4
+
+void test_fsm_signal_batch(void **state){
+    struct fsm_config_pointer configs[3] = {
+            { .ttl_activated = false },
+            { .lockfree_input = true },
+            { .input_capacity = 16, .input_overflow_policy = FSM_RING_BLOCK },
+    };
+    struct fsm_event *events[BATCH_LEN];
+    fsm_event_id next = fsm_event_register("NEXT");
+    for (int c = 0; c < 3; c++){
+        struct fsm_pointer *fsm = fsm_create_pointer_config(configs[c]);
+        int value = 0;
+        struct fsm_step *step_0 = fsm_create_step(callback_increment_int_from_step, (void *)&value);
+        struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+        fsm_connect_step_id(step_0, step_0, next);
+        fsm_connect_step(step_0, step_1, "DONE");
+        fsm_start_pointer(fsm, step_0);
+
+        for (int b = 0; b < BATCH_COUNT; b++){
+            for (int i = 0; i < BATCH_LEN; i++){
+                events[i] = fsm_generate_event_id(next, NULL);
+            }
+            assert_int_equal(fsm_signal_pointer_of_events(fsm, events, BATCH_LEN), BATCH_LEN);
+        }
+        assert_int_equal(fsm_signal_pointer_of_events(fsm, events, 0), 0);
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("DONE", NULL));
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, 5000), 0);
+        assert_int_equal(value, 1 + BATCH_LEN * BATCH_COUNT);
+
+        fsm_join_pointer(fsm);
+        fsm_delete_pointer(fsm);
+        fsm_delete_all_steps();
+    }
+}
+
+#define SPIN_ROUNDS 200
+
+void test_fsm_spin_wait(void **state){
+    struct fsm_config_pointer configs[2] = {
+            { .wait_spin = 4096, .wait_yield = 4 },
+            { .lockfree_input = true, .wait_spin = 4096, .wait_yield = 4 },
+    };
+    for (int c = 0; c < 2; c++){
+        struct fsm_pointer *fsm = fsm_create_pointer_config(configs[c]);
+        struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+        fsm_connect_step(step_0, step_1, "PING");
+        fsm_connect_step(step_1, step_0, "PING");
+        fsm_connect_step(step_0, step_2, "DONE");
+        fsm_connect_step(step_2, step_3, _EVENT_TIMEOUT_UID);
+        fsm_set_timeout_to_step(step_2, 10000);
+        fsm_start_pointer(fsm, step_0);
+
+        for (int i = 0; i < SPIN_ROUNDS; i++){
+            fsm_signal_pointer_of_event(fsm, fsm_generate_event("PING", NULL));
+            assert_int_equal(fsm_wait_step_mstimeout(fsm, i % 2 == 0 ? step_1 : step_0, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        }
+        // A spinning pointer still reaches the timeout of a step
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("DONE", NULL));
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+
+        fsm_join_pointer(fsm);
+        assert_in_range(fsm->input_spin.spin, 16, 4096);
+        fsm_delete_pointer(fsm);
+        fsm_delete_all_steps();
+    }
+}
+
+#define EXECUTOR_WORKERS 3
+#define EXECUTOR_POINTERS 200
+#define EXECUTOR_PINGS 10
+
+void *callback_count_step(struct fsm_context *context){
+    __atomic_add_fetch((int *)context->fnct_arg, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+void test_fsm_executor(void **state){
+    struct fsm_executor *executor = fsm_executor_create(EXECUTOR_WORKERS);
+    struct fsm_config_pointer configs[3] = {
+            { .executor = executor },
+            { .lockfree_input = true, .executor = executor },
+            { .input_capacity = 4, .input_overflow_policy = FSM_RING_BLOCK, .executor = executor },
+    };
+    struct fsm_pointer *fsm[EXECUTOR_POINTERS];
+    for (int c = 0; c < 3; c++){
+        int pings = 0;
+        struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_1 = fsm_create_step(callback_count_step, &pings);
+        struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+        fsm_connect_step(step_0, step_1, "PING");
+        fsm_connect_step(step_1, step_0, "PING");
+        fsm_connect_step(step_0, step_2, "DONE");
+        fsm_connect_step(step_2, step_3, _EVENT_TIMEOUT_UID);
+        fsm_set_timeout_to_step(step_2, 10000);
+        // Far more pointers than workers
+        for (int i = 0; i < EXECUTOR_POINTERS; i++){
+            fsm[i] = fsm_create_pointer_config(configs[c]);
+            assert_int_equal(fsm_start_pointer(fsm[i], step_0), 0);
+        }
+        for (int p = 0; p < 2 * EXECUTOR_PINGS; p++){
+            for (int i = 0; i < EXECUTOR_POINTERS; i++){
+                fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("PING", NULL));
+            }
+        }
+        // Every pointer handles its events in order then reaches the timeout of its step
+        for (int i = 0; i < EXECUTOR_POINTERS; i++){
+            fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("DONE", NULL));
+        }
+        for (int i = 0; i < EXECUTOR_POINTERS; i++){
+            assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        }
+        assert_int_equal(__atomic_load_n(&pings, __ATOMIC_RELAXED), EXECUTOR_POINTERS * EXECUTOR_PINGS);
+        for (int i = 0; i < EXECUTOR_POINTERS; i++){
+            fsm_delete_pointer(fsm[i]);
+        }
+        fsm_delete_all_steps();
+    }
+    fsm_executor_delete(executor);
+}
+
+void test_fsm_executor_timeouts(void **state){
+    struct fsm_executor *executor = fsm_executor_create(2);
+    struct fsm_config_pointer config = { .executor = executor };
+    struct fsm_pointer *fsm[EXECUTOR_POINTERS];
+    struct fsm_step *step_short = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_long = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_left = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_timeout = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_short, step_left, "LEAVE");
+    fsm_connect_step(step_long, step_left, "LEAVE");
+    fsm_connect_step(step_short, step_timeout, _EVENT_TIMEOUT_UID);
+    fsm_connect_step(step_long, step_timeout, _EVENT_TIMEOUT_UID);
+    fsm_set_timeout_to_step(step_short, 20000);
+    fsm_set_timeout_to_step(step_long, 60000);
+    for (int i = 0; i < EXECUTOR_POINTERS; i++){
+        fsm[i] = fsm_create_pointer_config(config);
+        fsm_start_pointer(fsm[i], i % 2 == 0 ? step_short : step_long);
+    }
+
+    // Timeouts are cancelled from anywhere into the deadline heap, the others are raised
+    for (int i = 0; i < EXECUTOR_POINTERS; i += 3){
+        fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("LEAVE", NULL));
+    }
+    for (int i = 0; i < EXECUTOR_POINTERS; i++){
+        struct fsm_step *step = i % 3 == 0 ? step_left : step_timeout;
+        assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    }
+    usleep(80000);
+    for (int i = 0; i < EXECUTOR_POINTERS; i += 3){
+        assert_ptr_equal(__atomic_load_n(&fsm[i]->current_step, __ATOMIC_ACQUIRE), step_left);
+    }
+    assert_int_equal(__atomic_load_n(&executor->n_timed, __ATOMIC_RELAXED), 0);
+
+    for (int i = 0; i < EXECUTOR_POINTERS; i++){
+        fsm_delete_pointer(fsm[i]);
+    }
+    fsm_delete_all_steps();
+    fsm_executor_delete(executor);
+}
+
+struct wait_other_pointer{
+    struct fsm_pointer *pointer;
+    struct fsm_step *step;
+    int rc;
+};
+
+void *callback_wait_other_pointer(struct fsm_context *context){
+    struct wait_other_pointer *wait = context->fnct_arg;
+    wait->rc = fsm_wait_step_mstimeout(wait->pointer, wait->step, AVG_WAIT_STEP_TIMEOUT_MS);
+    return NULL;
+}
+
+void test_fsm_executor_steal(void **state){
+    // Pointers are spread on the workers in the start order : fsm_0 and fsm_2 are queued on the first one
+    struct fsm_executor *executor = fsm_executor_create(2);
+    struct fsm_config_pointer config = { .executor = executor };
+    struct fsm_pointer *fsm_0 = fsm_create_pointer_config(config);
+    struct fsm_pointer *fsm_1 = fsm_create_pointer_config(config);
+    struct fsm_pointer *fsm_2 = fsm_create_pointer_config(config);
+    struct fsm_step *step_2_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct wait_other_pointer wait = { .pointer = fsm_2, .step = step_2_1, .rc = -1 };
+    struct fsm_step *step_0_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_0_1 = fsm_create_step(callback_wait_other_pointer, &wait);
+    fsm_connect_step(step_0_0, step_0_1, "GO");
+    fsm_connect_step(step_2_0, step_2_1, "GO");
+    fsm_start_pointer(fsm_0, step_0_0);
+    fsm_start_pointer(fsm_1, step_2_0);
+    fsm_start_pointer(fsm_2, step_2_0);
+
+    // The worker running fsm_0 is blocked until fsm_2 moves, which is only possible if the other worker steals it
+    fsm_signal_pointer_of_event(fsm_0, fsm_generate_event("GO", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm_0, step_0_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    fsm_signal_pointer_of_event(fsm_2, fsm_generate_event("GO", NULL));
+    fsm_join_pointer(fsm_0);
+    assert_int_equal(wait.rc, 0);
+
+    fsm_delete_pointer(fsm_0);
+    fsm_delete_pointer(fsm_1);
+    fsm_delete_pointer(fsm_2);
+    fsm_delete_all_steps();
+    fsm_executor_delete(executor);
+}
+
+void *callback_signal_own_pointer(struct fsm_context *context){
+    fsm_signal_pointer_of_event(context->pointer, fsm_generate_event("NEXT", NULL));
+    return NULL;
+}
+
+void test_fsm_dispatch(void **state){
+    struct fsm_config_pointer config = { .synchronous = true };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    struct fsm_pointer *threaded = fsm_create_pointer();
+    int value = 0;
+    int out = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(callback_increment_int_from_step, &value);
+    struct fsm_step *step_2 = fsm_create_step(callback_signal_own_pointer, NULL);
+    struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_4 = fsm_create_step(callback_increment_int_from_step, &value);
+    fsm_connect_step(step_0, step_1, "PING");
+    fsm_connect_step(step_1, step_0, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_connect_step(step_0, step_2, "GO");
+    fsm_connect_step(step_2, step_3, "NEXT");
+    fsm_connect_step(step_3, step_4, "NEXT");
+    step_4->out_fnct = callback_increment_int_from_step;
+    step_4->out_args = (void *) &out;
+
+    assert_int_equal(fsm_pointer_dispatch(fsm, fsm_generate_event("PING", NULL)), FSM_ERR_NOT_RUNNING);
+    assert_int_equal(fsm_start_pointer(fsm, step_0), 0);
+    // No thread : the first step and every transition are done when the call returns
+    assert_ptr_equal(fsm->current_step, step_0);
+    for (int i = 0; i < 10; i++){
+        assert_int_equal(fsm_pointer_dispatch(fsm, fsm_generate_event("PING", NULL)), 0);
+        assert_ptr_equal(fsm->current_step, step_0);
+        assert_int_equal(value, i + 1);
+    }
+    // Events signaled by a callback are handled before returning, then the ones signaled from outside
+    fsm_pointer_dispatch(fsm, fsm_generate_event("GO", NULL));
+    assert_ptr_equal(fsm->current_step, step_3);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("NEXT", NULL));
+    assert_ptr_equal(fsm->current_step, step_3);
+    fsm_pointer_dispatch(fsm, NULL);
+    assert_ptr_equal(fsm->current_step, step_4);
+    assert_int_equal(value, 11);
+
+    fsm_join_pointer(fsm);
+    assert_int_equal(fsm->running, FSM_STATE_STOPPED);
+    assert_int_equal(out, 1);
+    assert_int_equal(fsm_pointer_dispatch(threaded, fsm_generate_event("PING", NULL)), FSM_ERR_NOT_SYNCHRONOUS);
+    fsm_delete_pointer(fsm);
+    fsm_delete_pointer(threaded);
+    fsm_delete_all_steps();
+}
+
+static bool _test_fd_readable(int fd, int ms){
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    return poll(&pfd, 1, ms) == 1;
+}
+
+void test_fsm_pollable(void **state){
+    struct fsm_config_pointer config = { .synchronous = true };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    struct fsm_pointer *threaded = fsm_create_pointer();
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_1, "PING");
+    fsm_connect_step(step_1, step_0, "PING");
+    fsm_connect_step(step_0, step_2, _EVENT_TIMEOUT_UID);
+    fsm_set_timeout_to_step(step_0, 50000);
+    assert_int_equal(fsm_pointer_get_fd(threaded), -1);
+    int fd = fsm_pointer_get_fd(fsm);
+    assert_true(fd >= 0);
+    assert_int_equal(fsm_pointer_get_fd(fsm), fd);
+    fsm_start_pointer(fsm, step_0);
+
+    // Readable once created, then only when there is work to do
+    assert_true(_test_fd_readable(fd, 0));
+    assert_int_equal(fsm_pointer_run_ready(fsm, 10), 0);
+    assert_false(_test_fd_readable(fd, 0));
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("PING", NULL));
+    assert_true(_test_fd_readable(fd, 0));
+    assert_int_equal(fsm_pointer_run_ready(fsm, 10), 1);
+    assert_ptr_equal(fsm->current_step, step_1);
+    assert_false(_test_fd_readable(fd, 0));
+
+    // A busy pointer is run by parts
+    for (int i = 0; i < 5; i++){
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("PING", NULL));
+    }
+    assert_int_equal(fsm_pointer_run_ready(fsm, 2), 2);
+    assert_true(_test_fd_readable(fd, 0));
+    assert_int_equal(fsm_pointer_run_ready(fsm, 10), 3);
+    assert_ptr_equal(fsm->current_step, step_0);
+
+    // The timeout of the step makes it readable too
+    assert_true(_test_fd_readable(fd, AVG_WAIT_STEP_TIMEOUT_MS));
+    assert_int_equal(fsm_pointer_run_ready(fsm, 10), 1);
+    assert_ptr_equal(fsm->current_step, step_2);
+    assert_false(_test_fd_readable(fd, 0));
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_pointer(threaded);
+    fsm_delete_all_steps();
+}
+
+#define POLLABLE_SIGNALS 5000
+
+void *_test_fsm_pollable_producer(void *_pointer){
+    for (int i = 0; i < POLLABLE_SIGNALS; i++){
+        fsm_signal_pointer_of_event((struct fsm_pointer *)_pointer, fsm_generate_event("PING", NULL));
+        if (i % 16 == 0){
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+void test_fsm_pollable_signals(void **state){
+    struct fsm_config_pointer config = { .synchronous = true };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    pthread_t producer;
+    unsigned int handled = 0;
+    fsm_connect_step(step_0, step_1, "PING");
+    fsm_connect_step(step_1, step_0, "PING");
+    int fd = fsm_pointer_get_fd(fsm);
+    assert_true(fd >= 0);
+    fsm_start_pointer(fsm, step_0);
+
+    // Signals racing with the clear of the file descriptor must never leave an event without a wakeup
+    pthread_create(&producer, NULL, _test_fsm_pollable_producer, (void *) fsm);
+    while (handled < POLLABLE_SIGNALS){
+        assert_true(_test_fd_readable(fd, AVG_WAIT_STEP_TIMEOUT_MS));
+        handled += fsm_pointer_run_ready(fsm, 1 + handled % 3);
+    }
+    pthread_join(producer, NULL);
+    assert_int_equal(fsm_pointer_run_ready(fsm, 10), 0);
+    assert_ptr_equal(fsm->current_step, POLLABLE_SIGNALS % 2 == 0 ? step_0 : step_1);
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+#define TIMER_WHEEL_POINTERS 32
+
+static int timer_fired = 0;
+
+static void _test_timer_fired(struct fsm_timer *timer){
+    __atomic_add_fetch(&timer_fired, 1, __ATOMIC_RELAXED);
+}
+
+void test_fsm_timer_wheel(void **state){
+    struct fsm_timer_wheel *wheel = fsm_timer_wheel_create(1000);
+    struct fsm_executor *executor = fsm_executor_create(2);
+    struct fsm_config_pointer configs[3] = {
+            { .timer_wheel = wheel },
+            { .input_capacity = 4, .input_overflow_policy = FSM_RING_BLOCK, .timer_wheel = wheel },
+            { .executor = executor, .timer_wheel = wheel },
+    };
+    struct fsm_pointer *fsm[TIMER_WHEEL_POINTERS];
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_1, _EVENT_TIMEOUT_UID);
+    fsm_connect_step(step_0, step_2, "LEAVE");
+    fsm_connect_step(step_2, step_3, _EVENT_TIMEOUT_UID);
+    fsm_set_timeout_to_step(step_0, 20000);
+    fsm_set_timeout_to_step(step_2, 100000);
+    // Every pointer reaches the timeout of its step from the single wheel thread
+    for (int i = 0; i < TIMER_WHEEL_POINTERS; i++){
+        fsm[i] = fsm_create_pointer_config(configs[i % 3]);
+        assert_int_equal(fsm_start_pointer(fsm[i], step_0), 0);
+    }
+    for (int i = 0; i < TIMER_WHEEL_POINTERS; i++){
+        assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        fsm_delete_pointer(fsm[i]);
+    }
+
+    // The timeout of a step left early doesn't apply to the next one
+    for (int i = 0; i < 3; i++){
+        fsm[i] = fsm_create_pointer_config(configs[i]);
+        fsm_start_pointer(fsm[i], step_0);
+        fsm_signal_pointer_of_event(fsm[i], fsm_generate_event("LEAVE", NULL));
+    }
+    for (int i = 0; i < 3; i++){
+        assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step_2, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    }
+    usleep(40000);
+    for (int i = 0; i < 3; i++){
+        assert_ptr_equal(__atomic_load_n(&fsm[i]->current_step, __ATOMIC_ACQUIRE), step_2);
+    }
+    for (int i = 0; i < 3; i++){
+        assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        fsm_delete_pointer(fsm[i]);
+    }
+    fsm_delete_all_steps();
+
+    // A cancelled timer never fires, a moved one fires once
+    struct fsm_timer timers[2];
+    struct timespec soon = fsm_time_get_abs_fixed_time_from_us(5000);
+    fsm_timer_init(&timers[0], _test_timer_fired);
+    fsm_timer_init(&timers[1], _test_timer_fired);
+    fsm_timer_arm(wheel, &timers[0], &soon);
+    fsm_timer_arm(wheel, &timers[1], &soon);
+    fsm_timer_arm(wheel, &timers[1], &soon);
+    fsm_timer_cancel(wheel, &timers[0]);
+    usleep(50000);
+    fsm_timer_cancel_sync(wheel, &timers[1]);
+    assert_int_equal(__atomic_load_n(&timer_fired, __ATOMIC_RELAXED), 1);
+
+    fsm_executor_delete(executor);
+    fsm_timer_wheel_delete(wheel);
+}
+
+void test_fsm_delayed_event(void **state){
+    struct fsm_config_pointer config = { .input_capacity = 2, .input_overflow_policy = FSM_RING_BLOCK };
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    struct fsm_pointer *bounded = fsm_create_pointer_config(config);
+    int ticks = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(callback_count_step, &ticks);
+    fsm_connect_step(step_0, step_1, "LATER");
+    fsm_connect_step(step_1, step_1, "TICK");
+    fsm_start_pointer(fsm, step_0);
+    fsm_start_pointer(bounded, step_0);
+
+    fsm_signal_pointer_of_event_after(fsm, fsm_generate_event("LATER", NULL), 20000);
+    fsm_signal_pointer_of_event_after(bounded, fsm_generate_event("LATER", NULL), 20000);
+    assert_ptr_equal(__atomic_load_n(&fsm->current_step, __ATOMIC_ACQUIRE), step_0);
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    assert_int_equal(fsm_wait_step_mstimeout(bounded, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+
+    // Periodic events until cancelled, even into a bounded input smaller than the number of periods
+    struct fsm_event_timer *timers[2] = {
+            fsm_signal_pointer_of_event_every(fsm, fsm_event_register("TICK"), NULL, 5000),
+            fsm_signal_pointer_of_event_every(bounded, fsm_event_register("TICK"), NULL, 5000),
+    };
+    usleep(100000);
+    fsm_cancel_event_timer(timers[0]);
+    fsm_cancel_event_timer(timers[1]);
+    usleep(20000);
+    int counted = __atomic_load_n(&ticks, __ATOMIC_RELAXED);
+    assert_true(counted >= 2 + 4);
+    usleep(20000);
+    assert_int_equal(__atomic_load_n(&ticks, __ATOMIC_RELAXED), counted);
+
+    // Delayed events not signaled yet are released by the join
+    fsm_signal_pointer_of_event_after(fsm, fsm_generate_event("TICK", NULL), 10000000);
+    fsm_signal_pointer_of_event_every(bounded, fsm_event_register("TICK"), NULL, 10000000);
+    fsm_delete_pointer(fsm);
+    fsm_delete_pointer(bounded);
+    fsm_delete_all_steps();
+}
+
+void *callback_append_event_digit(struct fsm_context *context){
+    int *value = (int *) context->fnct_arg;
+    *value = *value * 10 + (int)(intptr_t) context->event->args;
+    return NULL;
+}
+
+#define TTL_NOISE_EVENTS 1000
+
+void test_fsm_ttl_store(void **state){
+    struct fsm_config_pointer config = { .ttl_activated = true };
+    struct fsm_pointer *fsm = fsm_create_pointer_config(config);
+    int digits = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(callback_append_event_digit, &digits);
+    struct fsm_step *step_3 = fsm_create_step(callback_append_event_digit, &digits);
+    struct fsm_step *step_4 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_1, "GO");
+    fsm_connect_step(step_1, step_2, "NEXT");
+    fsm_connect_step(step_2, step_3, "NEXT");
+    fsm_connect_step(step_3, step_4, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_start_pointer(fsm, step_0);
+
+    // Events which can't trigger any transition are kept, the short lived ones are dropped once expired
+    for (int i = 0; i < TTL_NOISE_EVENTS; i++){
+        fsm_event *noise = fsm_generate_event("NOISE", NULL);
+        noise->ttl = fsm_time_get_abs_fixed_time_from_us(i % 2 == 0 ? 10000 : INT_MAX);
+        fsm_signal_pointer_of_event(fsm, noise);
+    }
+    for (intptr_t i = 1; i <= 2; i++){
+        fsm_event *next = fsm_generate_event("NEXT", (void *) i);
+        next->ttl = fsm_time_get_abs_fixed_time_from_us(INT_MAX);
+        fsm_signal_pointer_of_event(fsm, next);
+    }
+    usleep(20000);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO", NULL));
+
+    // Kept events are tried again in their arrival order, step_4 is reached once the callback of step_3 returned
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_4, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    assert_int_equal(digits, 12);
+    assert_int_equal(fsm->ttl_store->count, TTL_NOISE_EVENTS / 2);
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+static int bus_args_freed = 0;
+
+static void _test_free_bus_args(void *args){
+    __atomic_add_fetch(&bus_args_freed, 1, __ATOMIC_RELAXED);
+    free(args);
+}
+
+void *callback_read_shared_args(struct fsm_context *context){
+    __atomic_add_fetch((int *) context->fnct_arg, *(int *) context->event->args, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+#define BUS_SUBSCRIBERS 30
+
+void test_fsm_bus(void **state){
+    struct fsm_bus *bus = fsm_bus_create();
+    struct fsm_executor *executor = fsm_executor_create(2);
+    struct fsm_config_pointer configs[3] = {
+            { .ttl_activated = false },
+            { .input_capacity = 4, .input_overflow_policy = FSM_RING_BLOCK },
+            { .executor = executor },
+    };
+    struct fsm_pointer *fsm[BUS_SUBSCRIBERS];
+    int sum = 0;
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(callback_read_shared_args, &sum);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_1, "CONFIG");
+    fsm_connect_step(step_1, step_2, _EVENT_DIRECT_TRANSITION_UID);
+    for (int i = 0; i < BUS_SUBSCRIBERS; i++){
+        fsm[i] = fsm_create_pointer_config(configs[i % 3]);
+        fsm_start_pointer(fsm[i], step_0);
+        fsm_bus_subscribe(bus, "config", fsm[i]);
+    }
+    assert_int_equal(fsm_bus_publish(bus, "nobody", fsm_generate_event("CONFIG", NULL)), 0);
+
+    // Every subscriber reads the same args
+    int *value = malloc(sizeof(int));
+    *value = 3;
+    struct fsm_event *event = fsm_generate_event("CONFIG", value);
+    event->args_free = _test_free_bus_args;
+    assert_int_equal(fsm_bus_publish(bus, "config", event), BUS_SUBSCRIBERS);
+    for (int i = 0; i < BUS_SUBSCRIBERS; i++){
+        // Reached once the callback reading the args returned
+        assert_int_equal(fsm_wait_step_mstimeout(fsm[i], step_2, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    }
+    assert_int_equal(__atomic_load_n(&sum, __ATOMIC_RELAXED), 3 * BUS_SUBSCRIBERS);
+
+    // Deliveries still pending when a pointer is joined are released with it, each args are freed once by the last one
+    fsm_bus_unsubscribe(bus, "config", fsm[0]);
+    value = malloc(sizeof(int));
+    event = fsm_generate_event("CONFIG", value);
+    event->args_free = _test_free_bus_args;
+    assert_int_equal(fsm_bus_publish(bus, "config", event), BUS_SUBSCRIBERS - 1);
+    for (int i = 0; i < BUS_SUBSCRIBERS; i++){
+        fsm_bus_unsubscribe(bus, "config", fsm[i]);
+        fsm_delete_pointer(fsm[i]);
+    }
+    assert_int_equal(__atomic_load_n(&bus_args_freed, __ATOMIC_RELAXED), 2);
+
+    fsm_executor_delete(executor);
+    fsm_bus_delete(bus);
+    fsm_delete_all_steps();
+}
+
+struct priority_counters{
+    int gate_open;
+    int routine;
+    int routine_before_urgent;
+};
+
+void *callback_wait_gate(struct fsm_context *context){
+    struct priority_counters *counters = context->fnct_arg;
+    while (!__atomic_load_n(&counters->gate_open, __ATOMIC_ACQUIRE)){
+        usleep(1000);
+    }
+    return NULL;
+}
+
+void *callback_count_routine(struct fsm_context *context){
+    ((struct priority_counters *) context->fnct_arg)->routine++;
+    return NULL;
+}
+
+void *callback_urgent(struct fsm_context *context){
+    struct priority_counters *counters = context->fnct_arg;
+    counters->routine_before_urgent = counters->routine;
+    return NULL;
+}
+
+#define PRIORITY_ROUTINE_EVENTS 1000
+
+void test_fsm_priority_lanes(void **state){
+    struct fsm_executor *executor = fsm_executor_create(1);
+    struct fsm_config_pointer configs[4] = {
+            { .ttl_activated = false },
+            { .lockfree_input = true },
+            { .input_capacity = 2 * PRIORITY_ROUTINE_EVENTS, .input_overflow_policy = FSM_RING_BLOCK },
+            { .executor = executor },
+    };
+    for (int c = 0; c < 4; c++){
+        struct priority_counters counters = { .gate_open = 0, .routine = 0, .routine_before_urgent = -1 };
+        struct fsm_pointer *fsm = fsm_create_pointer_config(configs[c]);
+        struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+        struct fsm_step *step_gate = fsm_create_step(callback_wait_gate, &counters);
+        struct fsm_step *step_routine = fsm_create_step(callback_count_routine, &counters);
+        struct fsm_step *step_urgent = fsm_create_step(callback_urgent, &counters);
+        struct fsm_step *step_done = fsm_create_step(fsm_null_callback, NULL);
+        fsm_connect_step(step_0, step_gate, "GATE");
+        fsm_connect_step(step_gate, step_routine, "ROUTINE");
+        fsm_connect_step(step_routine, step_routine, "ROUTINE");
+        fsm_connect_step(step_gate, step_urgent, "URGENT");
+        fsm_connect_step(step_routine, step_urgent, "URGENT");
+        fsm_connect_step(step_urgent, step_done, _EVENT_DIRECT_TRANSITION_UID);
+        fsm_start_pointer(fsm, step_0);
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("GATE", NULL));
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_gate, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+
+        // The pointer is busy while routine events pile up, the urgent one still comes first
+        for (int i = 0; i < PRIORITY_ROUTINE_EVENTS; i++){
+            fsm_signal_pointer_of_event(fsm, fsm_generate_event("ROUTINE", NULL));
+        }
+        struct fsm_event *urgent = fsm_generate_event("URGENT", NULL);
+        urgent->priority = FSM_PRIORITY_LANES - 1;
+        assert_int_equal(fsm_signal_pointer_of_event(fsm, urgent), 0);
+        __atomic_store_n(&counters.gate_open, 1, __ATOMIC_RELEASE);
+
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_done, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        assert_int_equal(counters.routine_before_urgent, 0);
+        fsm_delete_pointer(fsm);
+        fsm_delete_all_steps();
+    }
+    fsm_executor_delete(executor);
+}
+
+struct coalesce_counters{
+    int gate_open;
+    int status;
+    int last_status;
+    int ticks;
+};
+
+int coalesce_args_freed = 0;
+
+void _test_free_coalesce_args(void *args){
+    __atomic_add_fetch(&coalesce_args_freed, 1, __ATOMIC_RELAXED);
+    free(args);
+}
+
+void *callback_coalesce_gate(struct fsm_context *context){
+    struct coalesce_counters *counters = context->fnct_arg;
+    while (!__atomic_load_n(&counters->gate_open, __ATOMIC_ACQUIRE)){
+        usleep(1000);
+    }
+    return NULL;
+}
+
+void *callback_coalesce_status(struct fsm_context *context){
+    struct coalesce_counters *counters = context->fnct_arg;
+    counters->status++;
+    counters->last_status = *(int *) context->event->args;
+    return NULL;
+}
+
+void *callback_coalesce_tick(struct fsm_context *context){
+    ((struct coalesce_counters *) context->fnct_arg)->ticks++;
+    return NULL;
+}
+
+#define COALESCE_STATUS_EVENTS 100
+
+void test_fsm_coalesce(void **state){
+    struct coalesce_counters counters = { .gate_open = 0, .status = 0, .last_status = -1, .ticks = 0 };
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    fsm_pointer_coalesce(fsm, fsm_event_register("STATUS"));
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_gate = fsm_create_step(callback_coalesce_gate, &counters);
+    struct fsm_step *step_status = fsm_create_step(callback_coalesce_status, &counters);
+    struct fsm_step *step_tick = fsm_create_step(callback_coalesce_tick, &counters);
+    struct fsm_step *step_end = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_done = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_gate, "GATE");
+    fsm_connect_step(step_gate, step_status, "STATUS");
+    fsm_connect_step(step_status, step_status, "STATUS");
+    fsm_connect_step(step_status, step_tick, "TICK");
+    fsm_connect_step(step_tick, step_tick, "TICK");
+    fsm_connect_step(step_tick, step_end, "END");
+    fsm_connect_step(step_end, step_done, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_start_pointer(fsm, step_0);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("GATE", NULL));
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_gate, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+
+    // While the pointer is busy, each status replaces the pending one but other events still queue up
+    for (int i = 0; i < COALESCE_STATUS_EVENTS; i++){
+        int *value = malloc(sizeof(int));
+        *value = i;
+        struct fsm_event *event = fsm_generate_event("STATUS", value);
+        event->args_free = _test_free_coalesce_args;
+        assert_int_equal(fsm_signal_pointer_of_event(fsm, event), 0);
+        if (i % 10 == 0){
+            fsm_signal_pointer_of_event(fsm, fsm_generate_event("TICK", NULL));
+        }
+    }
+    assert_int_equal(__atomic_load_n(&coalesce_args_freed, __ATOMIC_RELAXED), COALESCE_STATUS_EVENTS - 1);
+    fsm_signal_pointer_of_event(fsm, fsm_generate_event("END", NULL));
+    __atomic_store_n(&counters.gate_open, 1, __ATOMIC_RELEASE);
+
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_done, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    assert_int_equal(counters.status, 1);
+    assert_int_equal(counters.last_status, COALESCE_STATUS_EVENTS - 1);
+    assert_int_equal(counters.ticks, COALESCE_STATUS_EVENTS / 10);
+    fsm_delete_pointer(fsm);
+    assert_int_equal(__atomic_load_n(&coalesce_args_freed, __ATOMIC_RELAXED), COALESCE_STATUS_EVENTS);
+    fsm_delete_all_steps();
+}
+
+struct step_waiter_arg{
+    struct fsm_pointer *pointer;
+    struct fsm_step *step;
+    char leave;
+    unsigned int mstimeout;
+    int rc;
+};
+
+void *_test_fsm_step_waiter(void *_arg){
+    struct step_waiter_arg *arg = _arg;
+    if (arg->leave){
+        arg->rc = fsm_wait_leaving_step_mstimeout(arg->pointer, arg->step, arg->mstimeout);
+    }else{
+        arg->rc = fsm_wait_step_mstimeout(arg->pointer, arg->step, arg->mstimeout);
+    }
+    return NULL;
+}
+
+int _test_fsm_count_step_waiters(struct fsm_pointer *pointer){
+    int count = 0;
+    pthread_mutex_lock(&pointer->mutex);
+    for (struct fsm_step_waiter *waiter = pointer->step_waiters; waiter != NULL; waiter = waiter->next){
+        count++;
+    }
+    pthread_mutex_unlock(&pointer->mutex);
+    return count;
+}
+
+#define STEP_WAITERS 4
+
+void test_fsm_step_waiters(void **state){
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    struct fsm_step *steps[STEP_WAITERS];
+    for (int i = 0; i < STEP_WAITERS; i++){
+        steps[i] = fsm_create_step(fsm_null_callback, NULL);
+    }
+    struct fsm_step *step_never = fsm_create_step(fsm_null_callback, NULL);
+    for (int i = 0; i + 1 < STEP_WAITERS; i++){
+        fsm_connect_step(steps[i], steps[i + 1], "NEXT");
+    }
+    fsm_start_pointer(fsm, steps[0]);
+
+    // Threads wait for the last step or for leaving the first one, one more for a step never reached
+    pthread_t threads[STEP_WAITERS + 1];
+    struct step_waiter_arg args[STEP_WAITERS + 1];
+    for (int i = 0; i < STEP_WAITERS + 1; i++){
+        args[i] = (struct step_waiter_arg) { .pointer = fsm, .leave = i % 2, .rc = -1,
+                                             .step = i % 2 ? steps[0] : steps[STEP_WAITERS - 1],
+                                             .mstimeout = AVG_WAIT_STEP_TIMEOUT_MS };
+    }
+    args[0].step = step_never;
+    args[0].mstimeout = 100;
+    for (int i = 0; i < STEP_WAITERS + 1; i++){
+        pthread_create(&threads[i], NULL, _test_fsm_step_waiter, &args[i]);
+    }
+    while (_test_fsm_count_step_waiters(fsm) < STEP_WAITERS + 1){
+        usleep(1000);
+    }
+    for (int i = 0; i + 1 < STEP_WAITERS; i++){
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("NEXT", NULL));
+    }
+    for (int i = 0; i < STEP_WAITERS + 1; i++){
+        pthread_join(threads[i], NULL);
+    }
+    assert_int_equal(args[0].rc, ETIMEDOUT);
+    for (int i = 1; i < STEP_WAITERS + 1; i++){
+        assert_int_equal(args[i].rc, 0);
+    }
+    // Waiters unregister themselves
+    assert_int_equal(_test_fsm_count_step_waiters(fsm), 0);
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+struct fsm_event *system_events[3];
+
+void *callback_keep_system_event(struct fsm_context *context){
+    int index = *(int *) context->fnct_arg;
+    system_events[index] = context->event;
+    return NULL;
+}
+
+void test_fsm_system_events(void **state){
+    int indexes[3] = {0, 1, 2};
+    struct fsm_step *step_0 = fsm_create_step(callback_keep_system_event, &indexes[0]);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_2 = fsm_create_step(callback_keep_system_event, &indexes[2]);
+    struct fsm_step *step_3 = fsm_create_step(fsm_null_callback, NULL);
+    step_0->out_fnct = callback_keep_system_event;
+    step_0->out_args = &indexes[1];
+    fsm_connect_step(step_0, step_1, "GO");
+    fsm_connect_step(step_1, step_2, _EVENT_TIMEOUT_UID);
+    fsm_connect_step(step_2, step_3, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_set_timeout_to_step(step_1, 1000);
+
+    // Start, out action and timeout events are the same preallocated ones for every pointer
+    struct fsm_event *seen[2][3];
+    for (int i = 0; i < 2; i++){
+        struct fsm_pointer *fsm = fsm_create_pointer();
+        fsm_start_pointer(fsm, step_0);
+        fsm_signal_pointer_of_event(fsm, fsm_generate_event("GO", NULL));
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_3, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        for (int e = 0; e < 3; e++){
+            seen[i][e] = system_events[e];
+            assert_true(seen[i][e]->preallocated);
+        }
+        assert_int_equal(seen[i][0]->id, _EVENT_START_POINTER_ID);
+        assert_int_equal(seen[i][1]->id, _EVENT_OUT_ACTION_ID);
+        assert_int_equal(seen[i][2]->id, _EVENT_TIMEOUT_ID);
+        // Releasing a system event does nothing, the join still has its own stop event
+        fsm_event_release(seen[i][0]);
+        assert_true(fsm->stop_event.preallocated);
+        fsm_delete_pointer(fsm);
+    }
+    for (int e = 0; e < 3; e++){
+        assert_ptr_equal(seen[0][e], seen[1][e]);
+    }
+    fsm_delete_all_steps();
+}
+
+struct payload_position{
+    int x;
+    int y;
+    double speed;
+};
+
+void *callback_read_payload(struct fsm_context *context){
+    unsigned int size;
+    struct payload_position *position = fsm_event_get_payload(context->event, &size);
+    struct payload_position *read = context->fnct_arg;
+    if (position != NULL && size == sizeof(struct payload_position)){
+        *read = *position;
+    }
+    return NULL;
+}
+
+void test_fsm_event_payload(void **state){
+    fsm_event_id move = fsm_event_register("MOVE");
+    struct payload_position read = { 0, 0, 0.0 };
+    struct fsm_pointer *fsm = fsm_create_pointer();
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(callback_read_payload, &read);
+    struct fsm_step *step_2 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step_id(step_0, step_1, move);
+    fsm_connect_step(step_1, step_2, _EVENT_DIRECT_TRANSITION_UID);
+    fsm_start_pointer(fsm, step_0);
+
+    // The payload is copied, the producer can reuse its own variable at once
+    struct payload_position position = { 3, 4, 1.5 };
+    struct fsm_event *event = fsm_generate_event_payload(move, &position, sizeof(position));
+    position.x = -1;
+    assert_null(event->args);
+    // The payload is on the same cache line as the event ID
+    assert_int_equal((uintptr_t) event % FSM_CACHE_LINE_SIZE, 0);
+    fsm_signal_pointer_of_event(fsm, event);
+    assert_int_equal(fsm_wait_step_mstimeout(fsm, step_2, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+    assert_int_equal(read.x, 3);
+    assert_int_equal(read.y, 4);
+    assert_true(read.speed == 1.5);
+
+    // Events without payload have none
+    struct fsm_event *empty = fsm_generate_event_id(move, NULL);
+    unsigned int size = 1;
+    assert_null(fsm_event_get_payload(empty, &size));
+    assert_int_equal(size, 0);
+    fsm_event_release(empty);
+
+    fsm_delete_pointer(fsm);
+    fsm_delete_all_steps();
+}
+
+void test_fsm_clock_source(void **state){
+    unsigned short sources[2] = { FSM_CLOCK_COARSE, FSM_CLOCK_TSC };
+    struct fsm_step *step_0 = fsm_create_step(fsm_null_callback, NULL);
+    struct fsm_step *step_1 = fsm_create_step(fsm_null_callback, NULL);
+    fsm_connect_step(step_0, step_1, _EVENT_TIMEOUT_UID);
+    fsm_set_timeout_to_step(step_0, 20000);
+    for (int i = 0; i < 2; i++){
+        // A clock which isn't available falls back to the precise one
+        unsigned short source = fsm_time_set_clock(sources[i]);
+        assert_true(source == sources[i] || source == FSM_CLOCK_PRECISE);
+        assert_int_equal(fsm_time_get_clock(), source);
+        assert_false(fsm_time_check_absolute_time(fsm_time_get_abs_fixed_time_from_us(-1000)));
+        assert_true(fsm_time_check_absolute_time(fsm_time_get_abs_fixed_time_from_us(1000000)));
+
+        // Timeouts are still raised, at most the clock resolution early
+        struct timespec start, end;
+        clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &start);
+        struct fsm_pointer *fsm = fsm_create_pointer();
+        fsm_start_pointer(fsm, step_0);
+        assert_int_equal(fsm_wait_step_mstimeout(fsm, step_1, AVG_WAIT_STEP_TIMEOUT_MS), 0);
+        clock_gettime(FSM_CLOCK_MONOTONIC_SOURCE, &end);
+        assert_true(fsm_time_delta_ns64(start, end) >= 10000000);
+        fsm_delete_pointer(fsm);
+    }
+    assert_int_equal(fsm_time_set_clock(FSM_CLOCK_PRECISE), FSM_CLOCK_PRECISE);
+    fsm_delete_all_steps();
+}
 
 int main(void)
 {
     srand ((unsigned int) time(NULL));
-    const struct CMUnitTest tests[11] = {
+    const struct CMUnitTest tests[36] = {
             cmocka_unit_test(test_fsm_start_stop),
             cmocka_unit_test(test_fsm_rand_transition),
             cmocka_unit_test(test_fsm_passing_value_by_step),
@@ -434,6 +1618,30 @@ int main(void)
             cmocka_unit_test(test_fsm_simple_timeout),
             cmocka_unit_test(test_fsm_simple_conditional_transition),
             cmocka_unit_test(test_fsm_multiple_conditional_transition),
+            cmocka_unit_test(test_fsm_event_id),
+            cmocka_unit_test(test_fsm_compiled_graph),
+            cmocka_unit_test(test_fsm_event_pool),
+            cmocka_unit_test(test_fsm_lockfree_input),
+            cmocka_unit_test(test_fsm_bounded_input),
+            cmocka_unit_test(test_fsm_bounded_join),
+            cmocka_unit_test(test_fsm_signal_batch),
+            cmocka_unit_test(test_fsm_spin_wait),
+            cmocka_unit_test(test_fsm_executor),
+            cmocka_unit_test(test_fsm_executor_timeouts),
+            cmocka_unit_test(test_fsm_executor_steal),
+            cmocka_unit_test(test_fsm_dispatch),
+            cmocka_unit_test(test_fsm_pollable),
+            cmocka_unit_test(test_fsm_pollable_signals),
+            cmocka_unit_test(test_fsm_timer_wheel),
+            cmocka_unit_test(test_fsm_delayed_event),
+            cmocka_unit_test(test_fsm_ttl_store),
+            cmocka_unit_test(test_fsm_bus),
+            cmocka_unit_test(test_fsm_priority_lanes),
+            cmocka_unit_test(test_fsm_coalesce),
+            cmocka_unit_test(test_fsm_step_waiters),
+            cmocka_unit_test(test_fsm_system_events),
+            cmocka_unit_test(test_fsm_event_payload),
+            cmocka_unit_test(test_fsm_clock_source),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
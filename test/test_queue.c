@@ -86,12 +86,41 @@ void test_queue_signal(void **state){
 
 }
 
+struct _test_queue_value {
+    int data;
+    struct fsm_queue_elem link;
+};
+
+void test_queue_intrusive(void **state){
+    struct fsm_queue queue = create_fsm_queue_intrusive(offsetof(struct _test_queue_value, link));
+    struct _test_queue_value values[3] = { {.data = 1}, {.data = 2}, {.data = 3} };
+    for (int i = 0; i < 3; i++){
+        // Values are stored as is, the link is the one embedded into them
+        assert_ptr_equal(fsm_queue_push_back_more(&queue, (void *) &values[i], sizeof(values[i]), 0), &values[i]);
+        assert_ptr_equal(queue.last, &values[i].link);
+    }
+    // Remove the middle one
+    assert_ptr_equal(fsm_queue_get_elem(&queue, (void *) &values[1]), &values[1]);
+    assert_ptr_equal(fsm_queue_pop_front(&queue), &values[0]);
+    assert_ptr_equal(fsm_queue_pop_front(&queue), &values[2]);
+    assert_ptr_equal(fsm_queue_pop_front(&queue), NULL);
+
+    // A copied value hold its own link
+    struct _test_queue_value *copy = fsm_queue_push_back(&queue, (void *) &values[0], sizeof(values[0]));
+    assert_ptr_not_equal(copy, &values[0]);
+    assert_int_equal(copy->data, 1);
+    assert_ptr_equal(queue.first, &copy->link);
+    fsm_queue_cleanup(&queue);
+    assert_ptr_equal(queue.first, NULL);
+}
+
 int main(void)
 {
     srand ((unsigned int) time(NULL));
-    const struct CMUnitTest tests[2] = {
+    const struct CMUnitTest tests[3] = {
             cmocka_unit_test(test_queue_push_pop_order),
-            cmocka_unit_test(test_queue_signal)
+            cmocka_unit_test(test_queue_signal),
+            cmocka_unit_test(test_queue_intrusive)
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -50,6 +50,21 @@ void test_time_delta(void **state){
     assert_int_equal(fsm_time_delta_ns(ts2, ts), -fsm_time_delta_ns(ts, ts2));
 }
 
+void test_time_delta64(void **state){
+    struct timespec ts = {
+            .tv_sec = 4,
+            .tv_nsec = 900000000,
+    };
+    struct timespec ts2 = {
+            .tv_sec = ts.tv_sec + 10,
+            .tv_nsec = 100,
+    };
+    // Far beyond what fsm_time_delta_ns can return
+    assert_true(fsm_time_delta_ns64(ts, ts2) == 9100000100LL);
+    assert_true(fsm_time_delta_ns64(ts2, ts) == -9100000100LL);
+    assert_int_equal(fsm_time_delta_ns(ts, ts2), INT_MAX);
+}
+
 void test_time_get_abs_fixed_time_from_us(void **state){
     will_return(__wrap_clock_gettime, -1);
     struct timespec ts = fsm_time_get_abs_fixed_time_from_us(1000);
@@ -76,9 +91,10 @@ void test_time_check_absolute_time(void **state){
 int main(void)
 {
     srand ((unsigned int) time(NULL));
-    const struct CMUnitTest tests[4] = {
+    const struct CMUnitTest tests[5] = {
             cmocka_unit_test(test_time_delta_overflow),
             cmocka_unit_test(test_time_delta),
+            cmocka_unit_test(test_time_delta64),
             cmocka_unit_test(test_time_get_abs_fixed_time_from_us),
             cmocka_unit_test(test_time_check_absolute_time),
     };